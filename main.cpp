@@ -1,4 +1,5 @@
 #include <SFML/Graphics.hpp>
+#include <SFML/Network.hpp>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -8,27 +9,254 @@
 #include <random>
 #include <vector>
 #include <cmath>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <queue>
+#include <deque>
+#include <unordered_set>
+#include <array>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdlib>
+#include <chrono>
+
+struct JobControl {
+    std::atomic<bool> cancelled;
+    std::atomic<float> progress;
+
+    JobControl() : cancelled(false), progress(0) {}
+};
+
+// Runs one job at a time on a background thread. Submitting a job replaces any queued one and
+// cancels the running one; results of cancelled jobs are dropped. Finished results are handed
+// over by swapping buffers, so the render loop never waits for a computation.
+template <typename Result>
+class ComputePipeline {
+public:
+    using Job = std::function<void(Result&, JobControl&)>;
+
+    ComputePipeline() : hasPending(false), running(false), ready(false), stopping(false), worker([this] { run(); }) {}
+
+    ~ComputePipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            if (control) {
+                control->cancelled = true;
+            }
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    void submit(Job job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = std::move(job);
+            hasPending = true;
+            if (control) {
+                control->cancelled = true;
+            }
+        }
+        wake.notify_one();
+    }
+
+    bool poll(Result& front) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ready) {
+            return false;
+        }
+        std::swap(front, completed);
+        ready = false;
+        return true;
+    }
+
+    bool busy() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hasPending || running;
+    }
+
+    float progress() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return control && !hasPending ? control->progress.load() : 0.f;
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || hasPending; });
+            if (stopping) {
+                return;
+            }
+            Job job = std::move(pending);
+            hasPending = false;
+            running = true;
+            control = std::make_shared<JobControl>();
+            std::shared_ptr<JobControl> current = control;
+            lock.unlock();
+
+            job(working, *current);
+
+            lock.lock();
+            running = false;
+            if (!current->cancelled) {
+                std::swap(working, completed);
+                ready = true;
+            }
+        }
+    }
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    Job pending;
+    bool hasPending;
+    bool running;
+    bool ready;
+    bool stopping;
+    std::shared_ptr<JobControl> control;
+    Result working;
+    Result completed;
+    std::thread worker;
+};
+
+namespace geometry {
+
+    template <typename T>
+    struct Kernel;
+
+    // Wide holds products of two coordinates, Lifted the fourth-degree terms of incircle.
+    template <>
+    struct Kernel<float> {
+        using Wide = float;
+        using Lifted = double;
+        static constexpr int lanes = 8;
+    };
+
+    template <>
+    struct Kernel<double> {
+        using Wide = double;
+        using Lifted = double;
+        static constexpr int lanes = 4;
+    };
+
+    // Pixel-snapped coordinates, evaluated in 64 bits: cross is exact for |x|, |y| < 2^30 and
+    // incircle for coordinate differences below 2^15.
+    template <>
+    struct Kernel<std::int32_t> {
+        using Wide = std::int64_t;
+        using Lifted = std::int64_t;
+        static constexpr int lanes = 8;
+    };
+
+    template <typename T>
+    using Wide = typename Kernel<T>::Wide;
+
+    template <typename T>
+    using Lifted = typename Kernel<T>::Lifted;
+
+    template <typename T>
+    Wide<T> cross(T ox, T oy, T ax, T ay, T bx, T by) {
+        return (Wide<T>(ax) - ox) * (Wide<T>(by) - oy) - (Wide<T>(ay) - oy) * (Wide<T>(bx) - ox);
+    }
+
+    template <typename T>
+    Wide<T> squaredDistance(T ax, T ay, T bx, T by) {
+        const Wide<T> dx = Wide<T>(bx) - ax;
+        const Wide<T> dy = Wide<T>(by) - ay;
+        return dx * dx + dy * dy;
+    }
+
+    // Positive when d lies inside the circle through a, b, c, given counter-clockwise.
+    template <typename T>
+    Lifted<T> incircle(T ax, T ay, T bx, T by, T cx, T cy, T dx, T dy) {
+        const Lifted<T> adx = Lifted<T>(ax) - dx, ady = Lifted<T>(ay) - dy;
+        const Lifted<T> bdx = Lifted<T>(bx) - dx, bdy = Lifted<T>(by) - dy;
+        const Lifted<T> cdx = Lifted<T>(cx) - dx, cdy = Lifted<T>(cy) - dy;
+        return (adx * adx + ady * ady) * (bdx * cdy - bdy * cdx) +
+            (bdx * bdx + bdy * bdy) * (cdx * ady - cdy * adx) +
+            (cdx * cdx + cdy * cdy) * (adx * bdy - ady * bdx);
+    }
+
+    template <typename T>
+    struct Sites {
+        std::vector<T> x, y;
+
+        void clear() {
+            x.clear();
+            y.clear();
+        }
+
+        void push_back(T px, T py) {
+            x.push_back(px);
+            y.push_back(py);
+        }
+
+        std::size_t size() const { return x.size(); }
+    };
+
+    template <typename T>
+    int nearestSite(const Sites<T>& sites, T px, T py) {
+        constexpr int lanes = Kernel<T>::lanes;
+        const std::size_t n = sites.size();
+        if (n == 0) {
+            return -1;
+        }
+
+        int closestIndex = 0;
+        Wide<T> minDist = squaredDistance(sites.x[0], sites.y[0], px, py);
+        Wide<T> dist[lanes];
+
+        std::size_t i = 0;
+        for (; i + lanes <= n; i += lanes) {
+            for (int lane = 0; lane < lanes; ++lane) {
+                dist[lane] = squaredDistance(sites.x[i + lane], sites.y[i + lane], px, py);
+            }
+            for (int lane = 0; lane < lanes; ++lane) {
+                if (dist[lane] < minDist) {
+                    minDist = dist[lane];
+                    closestIndex = static_cast<int>(i + lane);
+                }
+            }
+        }
+        for (; i < n; ++i) {
+            const Wide<T> d = squaredDistance(sites.x[i], sites.y[i], px, py);
+            if (d < minDist) {
+                minDist = d;
+                closestIndex = static_cast<int>(i);
+            }
+        }
+        return closestIndex;
+    }
+
+}
 
 struct Point {
     double x, y;
 };
 
-bool compare(Point a, Point b) {
+template <typename P>
+bool compare(const P& a, const P& b) {
     return (a.x < b.x) || (a.x == b.x && a.y < b.y);
 }
 
-double crossProduct(Point O, Point A, Point B) {
-    return (A.x - O.x) * (B.y - O.y) - (A.y - O.y) * (B.x - O.x);
+template <typename P>
+auto crossProduct(const P& O, const P& A, const P& B) {
+    return geometry::cross(O.x, O.y, A.x, A.y, B.x, B.y);
 }
 
-std::vector<Point> convexHull(std::vector<Point>& points) {
+// Works on any point type with x and y; integer coordinates (sf::Vector2i) give an exact hull.
+template <typename P>
+std::vector<P> convexHull(std::vector<P>& points) {
     int n = points.size();
     if (n <= 1)
         return points;
 
-    sort(points.begin(), points.end(), compare);
+    std::sort(points.begin(), points.end(), compare<P>);
 
-    std::vector<Point> lowerHull;
+    std::vector<P> lowerHull;
     for (int i = 0; i < n; ++i) {
         while (lowerHull.size() >= 2 &&
             crossProduct(lowerHull[lowerHull.size() - 2], lowerHull.back(), points[i]) <= 0) {
@@ -37,7 +265,7 @@ std::vector<Point> convexHull(std::vector<Point>& points) {
         lowerHull.push_back(points[i]);
     }
 
-    std::vector<Point> upperHull;
+    std::vector<P> upperHull;
     for (int i = n - 1; i >= 0; --i) {
         while (upperHull.size() >= 2 &&
             crossProduct(upperHull[upperHull.size() - 2], upperHull.back(), points[i]) <= 0) {
@@ -52,11 +280,6 @@ std::vector<Point> convexHull(std::vector<Point>& points) {
 
     return lowerHull;
 }
-float squaredDistance(sf::Vector2f p1, sf::Vector2f p2) {
-    float dx = p2.x - p1.x;
-    float dy = p2.y - p1.y;
-    return dx * dx + dy * dy;
-}
 
 class Button {
 public:
@@ -168,32 +391,6 @@ void Button::closeSubmenu() {
     }
 }
 
-void drawPointsHull(const std::vector<Point>& points, sf::RenderWindow& window) {
-    for (const auto& point : points) {
-        sf::CircleShape circle(5);
-        circle.setFillColor(sf::Color::Blue);
-        circle.setPosition(point.x, point.y);
-        window.draw(circle);
-    }
-}
-
-void drawConvexHull(const std::vector<Point>& convexHullPoints, sf::RenderWindow& window) {
-    for (std::size_t i = 1; i < convexHullPoints.size(); ++i) {
-        sf::Vertex line[] = {
-            sf::Vertex(sf::Vector2f(convexHullPoints[i - 1].x, convexHullPoints[i - 1].y), sf::Color::Red),
-            sf::Vertex(sf::Vector2f(convexHullPoints[i].x, convexHullPoints[i].y), sf::Color::Red)
-        };
-        window.draw(line, 2, sf::Lines);
-    }
-    if (!convexHullPoints.empty()) {
-        sf::Vertex lastLine[] = {
-            sf::Vertex(sf::Vector2f(convexHullPoints.back().x, convexHullPoints.back().y), sf::Color::Red),
-            sf::Vertex(sf::Vector2f(convexHullPoints.front().x, convexHullPoints.front().y), sf::Color::Red)
-        };
-
-        window.draw(lastLine, 2, sf::Lines);
-    }
-}
 void readPointsFromFile(std::vector<Point>& points) {
     double x, y;
     std::ifstream inputFile("points.txt");
@@ -231,24 +428,27 @@ void generateRandomPointsAndColors(int numPoints, int width, int height, std::ve
     }
 }
 
-void drawVoronoiDiagram(sf::RenderWindow& window, int width, int height, const std::vector<sf::Vector2f>& points, const std::vector<sf::Color>& colors) {
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int closestIndex = 0;
-            float minDist = squaredDistance(points[0], sf::Vector2f(x, y));
+template <typename T>
+void calculateVoronoiImage(const geometry::Sites<T>& sites, const std::vector<sf::Color>& colors, int width, int height, std::vector<sf::Uint8>& pixels, JobControl* control = nullptr) {
+    pixels.assign(static_cast<std::size_t>(width) * height * 4, 255);
+    if (sites.size() == 0) {
+        return;
+    }
 
-            for (size_t i = 1; i < points.size(); ++i) {
-                float dist = squaredDistance(points[i], sf::Vector2f(x, y));
-                if (dist < minDist) {
-                    minDist = dist;
-                    closestIndex = i;
-                }
+    for (int y = 0; y < height; ++y) {
+        if (control) {
+            if (control->cancelled) {
+                return;
             }
-
-            sf::RectangleShape pixel(sf::Vector2f(1, 1));
-            pixel.setPosition(x, y);
-            pixel.setFillColor(colors[closestIndex]);
-            window.draw(pixel);
+            control->progress = static_cast<float>(y) / height;
+        }
+        sf::Uint8* row = &pixels[static_cast<std::size_t>(y) * width * 4];
+        for (int x = 0; x < width; ++x) {
+            const sf::Color& color = colors[geometry::nearestSite(sites, static_cast<T>(x), static_cast<T>(y))];
+            row[4 * x] = color.r;
+            row[4 * x + 1] = color.g;
+            row[4 * x + 2] = color.b;
+            row[4 * x + 3] = 255;
         }
     }
 }
@@ -261,40 +461,6 @@ void drawPoints(sf::RenderWindow& window, const std::vector<sf::Vector2f>& point
         window.draw(circle);
     }
 }
-void calculateVoronoiDiagram3(const std::vector<Point>& points, std::vector<std::vector<Point>>& voronoiDiagram, int width, int height) {
-    voronoiDiagram.clear();
-    voronoiDiagram.resize(points.size());
-
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            float minDist = std::numeric_limits<float>::max();
-            int closestIndex = -1;
-
-            for (size_t i = 0; i < points.size(); ++i) {
-                sf::Vector2f currentPixel(static_cast<float>(x), static_cast<float>(y));
-                sf::Vector2f currentPoint(points[i].x, points[i].y);
-
-                float dist = squaredDistance(currentPoint, currentPixel);
-                if (dist < minDist) {
-                    minDist = dist;
-                    closestIndex = i;
-                }
-            }
-
-            voronoiDiagram[closestIndex].push_back({ static_cast<float>(x), static_cast<float>(y) });
-        }
-    }
-}
-void drawVoronoiDiagram3(sf::RenderWindow& window, const std::vector<std::vector<Point>>& voronoiDiagram, const std::vector<sf::Color>& colors) {
-    for (size_t i = 0; i < voronoiDiagram.size(); ++i) {
-        for (const auto& point : voronoiDiagram[i]) {
-            sf::RectangleShape pixel(sf::Vector2f(1, 1));
-            pixel.setPosition(point.x, point.y);
-            pixel.setFillColor(colors[i]);
-            window.draw(pixel);
-        }
-    }
-}
 void drawPoints3(sf::RenderWindow& window, const std::vector<Point>& points) {
     for (const auto& point : points) {
         sf::CircleShape circle(3);
@@ -399,20 +565,110 @@ namespace delaunay {
         std::vector<Edge<T>> edges;
     };
 
+    template <typename It>
+    struct Range {
+        It first, last;
+        It begin() const { return first; }
+        It end() const { return last; }
+    };
+
+    template <typename It>
+    Range<It> make_range(It first, It last) { return Range<It>{ first, last }; }
+
+    template <typename T>
+    class IncrementalMesh;
+
+    template <typename T>
+    struct Workspace {
+        std::vector<Edge<T>> edges;
+        std::vector<bool> remove;
+        std::vector<std::size_t> cavity;
+        std::vector<int> order;
+        std::vector<int> ids;
+        IncrementalMesh<T> incremental;
+    };
+
+    template <typename T>
+    void removeSharedEdges(std::vector<Edge<T>>& edges, std::vector<bool>& remove)
+    {
+        remove.assign(edges.size(), false);
+        for (auto it1 = edges.begin(); it1 != edges.end(); ++it1) {
+            for (auto it2 = edges.begin(); it2 != edges.end(); ++it2) {
+                if (it1 == it2) {
+                    continue;
+                }
+                if (*it1 == *it2) {
+                    remove[std::distance(edges.begin(), it1)] = true;
+                    remove[std::distance(edges.begin(), it2)] = true;
+                }
+            }
+        }
+
+        edges.erase(
+            std::remove_if(edges.begin(), edges.end(),
+                [&](auto const& e) { return remove[&e - &edges[0]]; }),
+            edges.end());
+    }
+
+    // One Bowyer-Watson step; pt must lie inside the current mesh (e.g. its super-triangle).
+    // The new fan overwrites the cavity's slots in d.triangles, so surviving triangles stay in place.
+    template <typename T>
+    void insertPoint(Delaunay<T>& d, const Point<T>& pt, Workspace<T>& ws)
+    {
+        ws.edges.clear();
+        ws.cavity.clear();
+        for (std::size_t i = 0; i < d.triangles.size(); ++i) {
+            auto const& tri = d.triangles[i];
+            const auto dist = (tri.circle.x - pt.x) * (tri.circle.x - pt.x) +
+                (tri.circle.y - pt.y) * (tri.circle.y - pt.y);
+            if ((dist - tri.circle.radius) <= eps) {
+                ws.cavity.push_back(i);
+                ws.edges.push_back(tri.e0);
+                ws.edges.push_back(tri.e1);
+                ws.edges.push_back(tri.e2);
+            }
+        }
+
+        removeSharedEdges(ws.edges, ws.remove);
+
+        std::size_t used = 0;
+        for (auto const& e : ws.edges) {
+            const Triangle<T> tri{ e.p0, e.p1, {pt.x, pt.y} };
+            if (used < ws.cavity.size()) {
+                d.triangles[ws.cavity[used++]] = tri;
+            }
+            else {
+                d.triangles.push_back(tri);
+            }
+        }
+        // A degenerate cavity can yield fewer fan triangles than it removed; drop the spare slots.
+        while (used < ws.cavity.size()) {
+            const auto slot = ws.cavity.back();
+            ws.cavity.pop_back();
+            if (slot + 1 != d.triangles.size()) {
+                d.triangles[slot] = d.triangles.back();
+            }
+            d.triangles.pop_back();
+        }
+    }
+
     template <
         typename T,
         typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
-    Delaunay<T> triangulate(const std::vector<Point<T>>& points)
+    void triangulate(const Point<T>* first, const Point<T>* last, Delaunay<T>& d, Workspace<T>& ws, JobControl* control = nullptr)
     {
         using Node = Point<T>;
-        if (points.size() < 3) {
-            return Delaunay<T>{};
+        d.triangles.clear();
+        d.edges.clear();
+        const auto count = static_cast<std::size_t>(last - first);
+        if (count < 3) {
+            return;
         }
-        auto xmin = points[0].x;
+        auto xmin = first->x;
         auto xmax = xmin;
-        auto ymin = points[0].y;
+        auto ymin = first->y;
         auto ymax = ymin;
-        for (auto const& pt : points) {
+        for (auto const& pt : make_range(first, last)) {
             xmin = std::min(xmin, pt.x);
             xmax = std::max(xmax, pt.x);
             ymin = std::min(ymin, pt.y);
@@ -425,53 +681,23 @@ namespace delaunay {
         const auto midx = (xmin + xmax) / static_cast<T>(2.);
         const auto midy = (ymin + ymax) / static_cast<T>(2.);
 
-        auto d = Delaunay<T>{};
+        d.triangles.reserve(2 * count + 1);
 
         const auto p0 = Node{ midx - 20 * dmax, midy - dmax };
         const auto p1 = Node{ midx, midy + 20 * dmax };
         const auto p2 = Node{ midx + 20 * dmax, midy - dmax };
         d.triangles.emplace_back(Triangle<T>{p0, p1, p2});
 
-        for (auto const& pt : points) {
-            std::vector<Edge<T>> edges;
-            std::vector<Triangle<T>> tmps;
-            for (auto const& tri : d.triangles) {
-
-                const auto dist = (tri.circle.x - pt.x) * (tri.circle.x - pt.x) +
-                    (tri.circle.y - pt.y) * (tri.circle.y - pt.y);
-                if ((dist - tri.circle.radius) <= eps) {
-                    edges.push_back(tri.e0);
-                    edges.push_back(tri.e1);
-                    edges.push_back(tri.e2);
-                }
-                else {
-                    tmps.push_back(tri);
-                }
-            }
-
-            std::vector<bool> remove(edges.size(), false);
-            for (auto it1 = edges.begin(); it1 != edges.end(); ++it1) {
-                for (auto it2 = edges.begin(); it2 != edges.end(); ++it2) {
-                    if (it1 == it2) {
-                        continue;
-                    }
-                    if (*it1 == *it2) {
-                        remove[std::distance(edges.begin(), it1)] = true;
-                        remove[std::distance(edges.begin(), it2)] = true;
-                    }
+        for (auto const& pt : make_range(first, last)) {
+            const auto inserted = static_cast<std::size_t>(&pt - first);
+            if (control && inserted % 256 == 0) {
+                if (control->cancelled) {
+                    d.triangles.clear();
+                    return;
                 }
+                control->progress = static_cast<float>(inserted) / count;
             }
-
-            edges.erase(
-                std::remove_if(edges.begin(), edges.end(),
-                    [&](auto const& e) { return remove[&e - &edges[0]]; }),
-                edges.end());
-
-
-            for (auto const& e : edges) {
-                tmps.push_back({ e.p0, e.p1, {pt.x, pt.y} });
-            }
-            d.triangles = tmps;
+            insertPoint(d, pt, ws);
         }
 
         d.triangles.erase(
@@ -483,99 +709,2807 @@ namespace delaunay {
                 }),
             d.triangles.end());
 
+        d.edges.reserve(3 * d.triangles.size());
         for (auto const& tri : d.triangles) {
             d.edges.push_back(tri.e0);
             d.edges.push_back(tri.e1);
             d.edges.push_back(tri.e2);
         }
+    }
+
+    template <
+        typename T,
+        typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
+    void triangulate(const std::vector<Point<T>>& points, Delaunay<T>& d, Workspace<T>& ws, JobControl* control = nullptr)
+    {
+        triangulate(points.data(), points.data() + points.size(), d, ws, control);
+    }
+
+    // Convenience form: the workspace is reused per thread, but each call allocates the returned
+    // mesh. Loops over many inputs should pass their own Delaunay and Workspace to the overload above.
+    template <
+        typename T,
+        typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
+    Delaunay<T> triangulate(const std::vector<Point<T>>& points)
+    {
+        static thread_local Workspace<T> workspace;
+        auto d = Delaunay<T>{};
+        triangulate(points, d, workspace);
         return d;
     }
 
-}
+    // Process-wide workers that sleep between jobs, so parallelFor does not start threads per call.
+    // One job runs at a time; a parallelFor issued from inside a job runs inline on its caller.
+    class ThreadPool {
+    public:
+        static ThreadPool& shared()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
 
-std::vector<delaunay::Point<double>> readPointsFromFile(const std::string& filename) {
-    std::vector<delaunay::Point<double>> points;
-    std::ifstream file(filename);
-    if (file.is_open()) {
-        std::string line;
-        while (std::getline(file, line)) {
-            std::istringstream iss(line);
-            double x, y;
-            if (iss >> x >> y) {
-                points.push_back(delaunay::Point<double>(x, y));
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) {
+                worker.join();
             }
         }
-        file.close();
-    }
-    else {
-        std::cerr << "Unable to open file: " << filename << std::endl;
-    }
-    return points;
-}
-void drawTrianglesAndPoints(const delaunay::Delaunay<double>& triangulation, const std::vector<delaunay::Point<double>>& points, sf::RenderWindow& window) {
-    for (const auto& triangle : triangulation.triangles) {
-        sf::ConvexShape shape(3);
-        shape.setPoint(0, sf::Vector2f(triangle.p0.x, triangle.p0.y));
-        shape.setPoint(1, sf::Vector2f(triangle.p1.x, triangle.p1.y));
-        shape.setPoint(2, sf::Vector2f(triangle.p2.x, triangle.p2.y));
-        shape.setFillColor(sf::Color::Transparent);
-        shape.setOutlineColor(sf::Color::Black);
-        shape.setOutlineThickness(1);
-        window.draw(shape);
-    }
 
-    for (const auto& point : points) {
-        sf::CircleShape circle(2);
-        circle.setFillColor(sf::Color::Black);
-        circle.setPosition(point.x - 2, point.y - 2);
-        window.draw(circle);
-    }
-}
-std::vector<Point> points;
-std::vector<Point> convexHullPoints;
+        // Calls job(id) once for every id in [0, threads); id 0 runs on the calling thread.
+        template <typename F>
+        void run(unsigned threads, F& job)
+        {
+            if (threads <= 1 || inside()) {
+                for (unsigned id = 0; id < threads; ++id) {
+                    job(id);
+                }
+                return;
+            }
+            std::lock_guard<std::mutex> serial(dispatch);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                while (workers.size() + 1 < threads) {
+                    const unsigned id = static_cast<unsigned>(workers.size()) + 1;
+                    workers.emplace_back([this, id] { work(id); });
+                }
+                invoke = &call<F>;
+                context = &job;
+                participants = threads;
+                remaining = threads - 1;
+                ++generation;
+            }
+            wake.notify_all();
 
+            inside() = true;
+            job(0);
+            inside() = false;
 
-int main() {
-    const int width = 2000;
-    const int height = 1200;
-    const int numPoints = 20;
-    sf::RenderWindow window(sf::VideoMode(width, height), "Lab-1");
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return remaining == 0; });
+        }
 
-    sf::Texture normalTexture, clickedTexture;
-    if (!normalTexture.loadFromFile("normal_button.png") || !clickedTexture.loadFromFile("clicked_button.png")) {
-        std::cerr << "Failed to load button textures." << std::endl;
-        return 1;
-    }
+    private:
+        ThreadPool() = default;
 
-    Button mainButton1(&normalTexture, &clickedTexture, "Main Button 1", sf::Vector2f(400, 400));
-    Button mainButton2(&normalTexture, &clickedTexture, "Main Button 2", sf::Vector2f(950, 400));
-    Button mainButton3(&normalTexture, &clickedTexture, "Main Button 3", sf::Vector2f(1500, 400));
+        template <typename F>
+        static void call(void* job, unsigned id) { (*static_cast<F*>(job))(id); }
 
-    sf::Texture submenuNormalTexture, submenuClickedTexture;
-    if (!submenuNormalTexture.loadFromFile("submenu_normal_button.png") || !submenuClickedTexture.loadFromFile("submenu_normal_button.png")) {
-        std::cerr << "Failed to load submenu button textures." << std::endl;
-        return 1;
-    }
+        static bool& inside()
+        {
+            static thread_local bool flag = false;
+            return flag;
+        }
 
-    Button submenuButton1(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 1", sf::Vector2f(400, 500));
-    Button submenuButton2(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 2", sf::Vector2f(400, 600));
-    Button submenuButton3(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 3", sf::Vector2f(400, 700));
+        void work(unsigned id)
+        {
+            inside() = true;
+            std::uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                if (id >= participants) {
+                    continue;
+                }
+                auto const task = invoke;
+                auto const job = context;
+                lock.unlock();
+                task(job, id);
+                lock.lock();
+                if (--remaining == 0) {
+                    done.notify_one();
+                }
+            }
+        }
 
-    mainButton1.addButton(&submenuButton1);
-    mainButton1.addButton(&submenuButton2);
-    mainButton1.addButton(&submenuButton3);
+        std::mutex dispatch;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::vector<std::thread> workers;
+        void (*invoke)(void*, unsigned) = nullptr;
+        void* context = nullptr;
+        unsigned participants = 0;
+        unsigned remaining = 0;
+        std::uint64_t generation = 0;
+        bool stopping = false;
+    };
 
-    Button submenuButton4(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 4", sf::Vector2f(950, 500));
-    Button submenuButton5(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 5", sf::Vector2f(950, 600));
-    Button submenuButton6(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 6", sf::Vector2f(950, 700));
+    template <typename F>
+    void parallelFor(std::size_t count, unsigned threads, F&& body)
+    {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(count, 1)));
+        const std::size_t chunk = std::max<std::size_t>(1, count / (threads * 16));
+        std::atomic<std::size_t> next{ 0 };
+
+        auto run = [&](unsigned worker) {
+            for (;;) {
+                const std::size_t begin = next.fetch_add(chunk);
+                if (begin >= count) {
+                    break;
+                }
+                const std::size_t end = std::min(count, begin + chunk);
+                for (std::size_t i = begin; i < end; ++i) {
+                    body(i, worker);
+                }
+            }
+        };
+        ThreadPool::shared().run(threads, run);
+    }
 
-    mainButton2.addButton(&submenuButton4);
-    mainButton2.addButton(&submenuButton5);
-    mainButton2.addButton(&submenuButton6);
+    template <typename T>
+    struct Batch {
+        std::vector<Triangle<T>> triangles;
+        std::vector<std::size_t> offsets;
+    };
 
-    Button submenuButton7(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 7", sf::Vector2f(1500, 500));
-    Button submenuButton8(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 8", sf::Vector2f(1500, 600));
-    Button submenuButton9(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 9", sf::Vector2f(1500, 700));
+    template <typename T>
+    struct BatchWorkspace {
+        struct Worker {
+            Workspace<T> workspace;
+            Delaunay<T> mesh;
+            std::vector<Triangle<T>> triangles;
+        };
+        struct Slot {
+            unsigned worker;
+            std::size_t first, count;
+        };
+        std::vector<Worker> workers;
+        std::vector<Slot> slots;
+    };
+
+    // Triangulates the point sets points[offsets[i] .. offsets[i + 1]) independently.
+    // Triangles of set i end up in out.triangles[out.offsets[i] .. out.offsets[i + 1]).
+    template <
+        typename T,
+        typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
+    void triangulateBatch(const std::vector<Point<T>>& points, const std::vector<std::size_t>& offsets,
+        Batch<T>& out, BatchWorkspace<T>& ws, unsigned threads = 0)
+    {
+        out.triangles.clear();
+        out.offsets.assign(1, 0);
+        if (offsets.size() < 2) {
+            return;
+        }
+        const std::size_t sets = offsets.size() - 1;
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (ws.workers.size() < threads) {
+            ws.workers.resize(threads);
+        }
+        for (auto& worker : ws.workers) {
+            worker.triangles.clear();
+        }
+        ws.slots.resize(sets);
+
+        parallelFor(sets, threads, [&](std::size_t set, unsigned id) {
+            auto& worker = ws.workers[id];
+            triangulate(points.data() + offsets[set], points.data() + offsets[set + 1], worker.mesh, worker.workspace);
+            ws.slots[set] = { id, worker.triangles.size(), worker.mesh.triangles.size() };
+            worker.triangles.insert(worker.triangles.end(), worker.mesh.triangles.begin(), worker.mesh.triangles.end());
+        });
+
+        std::size_t total = 0;
+        out.offsets.resize(sets + 1);
+        for (std::size_t set = 0; set < sets; ++set) {
+            total += ws.slots[set].count;
+            out.offsets[set + 1] = total;
+        }
+        out.triangles.reserve(total);
+        for (auto const& slot : ws.slots) {
+            auto const& source = ws.workers[slot.worker].triangles;
+            out.triangles.insert(out.triangles.end(), source.begin() + slot.first, source.begin() + slot.first + slot.count);
+        }
+    }
+
+    template <typename T>
+    T orient(const Point<T>& a, const Point<T>& b, const Point<T>& c)
+    {
+        return geometry::cross(a.x, a.y, b.x, b.y, c.x, c.y);
+    }
+
+    template <typename T>
+    bool lessPoint(const Point<T>& l, const Point<T>& r)
+    {
+        return (l.x < r.x) || (l.x == r.x && l.y < r.y);
+    }
+
+    // Position of (x, y) on a Hilbert curve over a 2^16 grid; inserting points in this order keeps
+    // point-location walks short.
+    inline std::uint32_t hilbertIndex(std::uint32_t x, std::uint32_t y)
+    {
+        std::uint32_t d = 0;
+        for (std::uint32_t s = 1u << 15; s > 0; s >>= 1) {
+            const std::uint32_t rx = (x & s) ? 1 : 0;
+            const std::uint32_t ry = (y & s) ? 1 : 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = 0xFFFF - x;
+                    y = 0xFFFF - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    template <typename T>
+    void hilbertOrder(const std::vector<Point<T>>& points, std::vector<int>& order)
+    {
+        order.resize(points.size());
+        if (points.empty()) {
+            return;
+        }
+        auto xmin = points[0].x, xmax = xmin, ymin = points[0].y, ymax = ymin;
+        for (auto const& p : points) {
+            xmin = std::min(xmin, p.x);
+            xmax = std::max(xmax, p.x);
+            ymin = std::min(ymin, p.y);
+            ymax = std::max(ymax, p.y);
+        }
+        const auto scale = 65535 / std::max({ xmax - xmin, ymax - ymin, static_cast<T>(eps) });
+        std::vector<std::pair<std::uint32_t, int>> keys(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            keys[i] = { hilbertIndex(static_cast<std::uint32_t>((points[i].x - xmin) * scale), static_cast<std::uint32_t>((points[i].y - ymin) * scale)), static_cast<int>(i) };
+        }
+        std::sort(keys.begin(), keys.end());
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            order[i] = keys[i].second;
+        }
+    }
+
+    // Indexed triangulation that grows by point and segment insertion. Triangles are counter-clockwise
+    // vertex triples; neighbours[t][i] is the triangle across the edge opposite vertex i (-1 outside)
+    // and flags[t][i] tags that edge. Cavities are grown from the triangle holding the new point through
+    // neighbour links and never cross a Constraint edge. Dead slots are reused, so a long-lived mesh
+    // only grows with its vertex count. The public vectors are read-only outside the class.
+    template <typename T>
+    class IncrementalMesh {
+    public:
+        enum : unsigned char { Constraint = 1, Boundary = 2, Hole = 4 };
+
+        // Empty mesh inside a super-triangle around the box; the super vertices are 0, 1 and 2.
+        void reset(T xmin, T ymin, T xmax, T ymax)
+        {
+            clear();
+            const auto dmax = std::max({ xmax - xmin, ymax - ymin, static_cast<T>(eps) });
+            const auto midx = (xmin + xmax) / 2;
+            const auto midy = (ymin + ymax) / 2;
+            vertices.emplace_back(midx - 20 * dmax, midy - dmax);
+            vertices.emplace_back(midx + 20 * dmax, midy - dmax);
+            vertices.emplace_back(midx, midy + 20 * dmax);
+            vertexTriangle.assign(3, -1);
+            superCount = 3;
+            addTriangle(0, 1, 2);
+            recent = 0;
+        }
+
+        // Mesh of an existing triangle list, with vertices in lessPoint order. Edges with a single
+        // triangle are tagged as constraints.
+        void assign(const Delaunay<T>& d)
+        {
+            clear();
+            for (auto const& tri : d.triangles) {
+                vertices.push_back(tri.p0);
+                vertices.push_back(tri.p1);
+                vertices.push_back(tri.p2);
+            }
+            std::sort(vertices.begin(), vertices.end(), lessPoint<T>);
+            vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+            vertexTriangle.assign(vertices.size(), -1);
+            auto indexOf = [&](const Point<T>& p) {
+                return static_cast<int>(std::lower_bound(vertices.begin(), vertices.end(), p, lessPoint<T>) - vertices.begin());
+            };
+            for (auto const& tri : d.triangles) {
+                addTriangle(indexOf(tri.p0), indexOf(tri.p1), indexOf(tri.p2));
+            }
+            stitch();
+            recent = triangles.empty() ? -1 : 0;
+        }
+
+        std::size_t superVertices() const { return static_cast<std::size_t>(superCount); }
+
+        // Visibility walk from hint (or the last insertion) to the triangle holding p; -1 when p is outside.
+        // With blocked set the walk does not cross Constraint edges and reports the one in the way as
+        // 3 * triangle + side.
+        int locate(const Point<T>& p, int hint = -1, int* blocked = nullptr) const
+        {
+            int t = hint >= 0 && hint < static_cast<int>(triangles.size()) && alive[hint] ? hint : recent;
+            if (t < 0 || t >= static_cast<int>(triangles.size()) || !alive[t]) {
+                t = static_cast<int>(std::find(alive.begin(), alive.end(), 1) - alive.begin());
+                if (t == static_cast<int>(alive.size())) {
+                    return -1;
+                }
+            }
+            if (blocked) {
+                *blocked = -1;
+            }
+            for (std::size_t step = 0; step <= triangles.size(); ++step) {
+                auto const& v = triangles[t];
+                int next = -1;
+                int barrier = -1;
+                bool inside = true;
+                for (int k = 0; k < 3 && next < 0; ++k) {
+                    const int i = static_cast<int>((k + step) % 3);
+                    if (orient(vertices[v[(i + 1) % 3]], vertices[v[(i + 2) % 3]], p) < 0) {
+                        inside = false;
+                        if (neighbours[t][i] >= 0 && !(blocked && (flags[t][i] & Constraint))) {
+                            next = neighbours[t][i];
+                        }
+                        else if (barrier < 0) {
+                            barrier = 3 * t + i;
+                        }
+                    }
+                }
+                if (inside) {
+                    return t;
+                }
+                if (next < 0 && blocked) {
+                    *blocked = barrier;
+                    return -1;
+                }
+                if (next < 0) {
+                    break;
+                }
+                t = next;
+            }
+            if (blocked) {
+                return -1;
+            }
+            // The walk can stall against holes in an assigned mesh; fall back to a scan.
+            for (std::size_t s = 0; s < triangles.size(); ++s) {
+                if (alive[s] && contains(static_cast<int>(s), p)) {
+                    return static_cast<int>(s);
+                }
+            }
+            return -1;
+        }
+
+        // Inserts p and returns its vertex, the existing vertex at p, or -1 when p is outside the mesh.
+        int insert(const Point<T>& p, int hint = -1)
+        {
+            const int t = locate(p, hint);
+            if (t < 0) {
+                return -1;
+            }
+            for (int v : triangles[t]) {
+                if (vertices[v] == p) {
+                    return v;
+                }
+            }
+            for (int i = 0; i < 3; ++i) {
+                if (onEdge(t, i, p)) {
+                    return insertAt(p, t, i);
+                }
+            }
+            return insertAt(p, t, -1);
+        }
+
+        // Inserts p on the edge opposite vertex side of t; both halves keep the edge's tags.
+        int split(int t, int side, const Point<T>& p)
+        {
+            return insertAt(p, t, side);
+        }
+
+        // Constraint edge on the boundary of p's cavity, grown from the triangle t holding p, whose
+        // diametral circle contains p; returned as 3 * triangle + side, or -1 when there is none.
+        int encroached(const Point<T>& p, int t)
+        {
+            growCavity(p, t, -1);
+            for (int c : cavity) {
+                for (int k = 0; k < 3; ++k) {
+                    const int n = neighbours[c][k];
+                    if ((n >= 0 && mark[n] == stamp) || !(flags[c][k] & Constraint)) {
+                        continue;
+                    }
+                    auto const& a = vertices[triangles[c][(k + 1) % 3]];
+                    auto const& b = vertices[triangles[c][(k + 2) % 3]];
+                    if ((a.x - p.x) * (b.x - p.x) + (a.y - p.y) * (b.y - p.y) < 0) {
+                        return 3 * c + k;
+                    }
+                }
+            }
+            return -1;
+        }
+
+        // Forces the edge ab into the mesh and tags it. Vertices on ab split it, and a Constraint edge
+        // crossing it is split at the intersection, so both constraints survive.
+        bool insertSegment(int a, int b, unsigned char tags = Constraint)
+        {
+            while (a != b) {
+                int t = -1, i = -1, next = -1;
+                aroundVertex(a, [&](int s, int k) {
+                    const int v1 = triangles[s][(k + 1) % 3];
+                    const int v2 = triangles[s][(k + 2) % 3];
+                    for (int v : { v1, v2 }) {
+                        if (v == b || collinear(a, b, v)) {
+                            next = v;
+                            return true;
+                        }
+                    }
+                    if (orient(vertices[a], vertices[v1], vertices[b]) > 0 && orient(vertices[a], vertices[v2], vertices[b]) < 0) {
+                        t = s;
+                        i = k;
+                        return true;
+                    }
+                    return false;
+                });
+                if (next >= 0) {
+                    int side = -1;
+                    const int s = findEdge(a, next, side);
+                    tagEdge(s, side, tags);
+                    a = next;
+                    continue;
+                }
+                if (t < 0) {
+                    return false;
+                }
+
+                // Walk along ab through the crossed triangles; lower and upper collect the chains right
+                // and left of the segment.
+                int lo = triangles[t][(i + 1) % 3];
+                int up = triangles[t][(i + 2) % 3];
+                int side = i;
+                int end = -1;
+                crossing.assign(1, t);
+                lower.assign(1, lo);
+                upper.assign(1, up);
+                for (;;) {
+                    if (flags[t][side] & Constraint) {
+                        const auto& A = vertices[a];
+                        const auto& B = vertices[b];
+                        const auto da = orient(vertices[lo], vertices[up], A);
+                        const auto db = orient(vertices[lo], vertices[up], B);
+                        const auto u = da / (da - db);
+                        if (split(t, side, Point<T>{ A.x + u * (B.x - A.x), A.y + u * (B.y - A.y) }) < 0) {
+                            return false;
+                        }
+                        break;
+                    }
+                    const int n = neighbours[t][side];
+                    if (n < 0) {
+                        return false;
+                    }
+                    const int w = triangles[n][indexOfNeighbour(n, t)];
+                    crossing.push_back(n);
+                    if (w == b || collinear(a, b, w)) {
+                        end = w;
+                        break;
+                    }
+                    if (orient(vertices[a], vertices[b], vertices[w]) > 0) {
+                        side = indexIn(n, up);
+                        upper.push_back(w);
+                        up = w;
+                    }
+                    else {
+                        side = indexIn(n, lo);
+                        lower.push_back(w);
+                        lo = w;
+                    }
+                    t = n;
+                }
+                if (end < 0) {
+                    continue;
+                }
+
+                nextStamp();
+                for (int c : crossing) {
+                    mark[c] = stamp;
+                }
+                sides.clear();
+                for (int c : crossing) {
+                    for (int k = 0; k < 3; ++k) {
+                        const int n = neighbours[c][k];
+                        if (n < 0 || mark[n] != stamp) {
+                            addOuterSide(c, k);
+                        }
+                    }
+                }
+                for (int c : crossing) {
+                    removeTriangle(c);
+                }
+                created.clear();
+                fillChain(a, end, upper.data(), upper.data() + upper.size());
+                fillChain(a, end, lower.data(), lower.data() + lower.size());
+                stitch();
+                int edgeSide = -1;
+                const int edge = findEdge(a, end, edgeSide);
+                tagEdge(edge, edgeSide, tags);
+                recent = created.back();
+                a = end;
+            }
+            return true;
+        }
+
+        // Flips unconstrained edges until every one of them is locally Delaunay, e.g. after assign()
+        // from a triangulation whose segments are unknown.
+        void makeDelaunay()
+        {
+            flipStack.clear();
+            for (std::size_t t = 0; t < triangles.size(); ++t) {
+                for (int i = 0; alive[t] && i < 3; ++i) {
+                    flipStack.push_back({ { static_cast<int>(t), i } });
+                }
+            }
+            while (!flipStack.empty()) {
+                const int t = flipStack.back()[0];
+                const int i = flipStack.back()[1];
+                flipStack.pop_back();
+                const int n = neighbours[t][i];
+                if (!alive[t] || n < 0 || (flags[t][i] & Constraint) || !inCircle(t, vertices[triangles[n][indexOfNeighbour(n, t)]])) {
+                    continue;
+                }
+                const int a = triangles[t][i];
+                const int b = triangles[t][(i + 1) % 3];
+                const int c = triangles[t][(i + 2) % 3];
+                const int d = triangles[n][indexOfNeighbour(n, t)];
+                sides.clear();
+                for (int s : { t, n }) {
+                    for (int k = 0; k < 3; ++k) {
+                        if (neighbours[s][k] != t && neighbours[s][k] != n) {
+                            addOuterSide(s, k);
+                        }
+                    }
+                }
+                removeTriangle(t);
+                removeTriangle(n);
+                created.clear();
+                addTriangle(a, b, d);
+                addTriangle(a, d, c);
+                stitch();
+                for (int s : created) {
+                    for (int k = 0; k < 3; ++k) {
+                        flipStack.push_back({ { s, k } });
+                    }
+                }
+            }
+        }
+
+        // Triangle with the edge ab and the side it is on, or -1.
+        int findEdge(int a, int b, int& side) const
+        {
+            int found = -1;
+            aroundVertex(a, [&](int t, int i) {
+                if (triangles[t][(i + 1) % 3] == b) {
+                    found = t;
+                    side = (i + 2) % 3;
+                }
+                else if (triangles[t][(i + 2) % 3] == b) {
+                    found = t;
+                    side = (i + 1) % 3;
+                }
+                return found >= 0;
+            });
+            return found;
+        }
+
+        // Copies the live triangles without super vertices (and with keep[t] set, if given) into d.
+        void exportTo(Delaunay<T>& d, const std::vector<char>* keep = nullptr) const
+        {
+            d.triangles.clear();
+            d.edges.clear();
+            for (std::size_t t = 0; t < triangles.size(); ++t) {
+                auto const& v = triangles[t];
+                if (!alive[t] || v[0] < superCount || v[1] < superCount || v[2] < superCount || (keep && !(*keep)[t])) {
+                    continue;
+                }
+                d.triangles.emplace_back(vertices[v[0]], vertices[v[1]], vertices[v[2]]);
+            }
+            d.edges.reserve(3 * d.triangles.size());
+            for (auto const& tri : d.triangles) {
+                d.edges.push_back(tri.e0);
+                d.edges.push_back(tri.e1);
+                d.edges.push_back(tri.e2);
+            }
+        }
+
+        std::vector<Point<T>> vertices;
+        std::vector<std::array<int, 3>> triangles;
+        std::vector<std::array<int, 3>> neighbours;
+        std::vector<std::array<unsigned char, 3>> flags;
+        std::vector<char> alive;
+        std::vector<int> vertexTriangle;
+        std::vector<int> created;
+
+    private:
+        struct Side {
+            int lo, hi, triangle, side;
+            bool outer;
+            unsigned char tags;
+        };
+
+        static constexpr T tolerance = static_cast<T>(1e-10);
+
+        void clear()
+        {
+            vertices.clear();
+            triangles.clear();
+            neighbours.clear();
+            flags.clear();
+            alive.clear();
+            vertexTriangle.clear();
+            created.clear();
+            freeSlots.clear();
+            sides.clear();
+            superCount = 0;
+            recent = -1;
+        }
+
+        void nextStamp()
+        {
+            if (++stamp == 0) {
+                std::fill(mark.begin(), mark.end(), 0u);
+                std::fill(vertexMark.begin(), vertexMark.end(), 0u);
+                stamp = 1;
+            }
+            if (mark.size() < triangles.size()) {
+                mark.resize(triangles.size(), 0);
+            }
+            if (vertexMark.size() < vertices.size()) {
+                vertexMark.resize(vertices.size(), 0);
+            }
+        }
+
+        int addTriangle(int a, int b, int c)
+        {
+            if (orient(vertices[a], vertices[b], vertices[c]) < 0) {
+                std::swap(b, c);
+            }
+            int t;
+            if (!freeSlots.empty()) {
+                t = freeSlots.back();
+                freeSlots.pop_back();
+                triangles[t] = { { a, b, c } };
+                neighbours[t] = { { -1, -1, -1 } };
+                flags[t] = { { 0, 0, 0 } };
+                alive[t] = 1;
+            }
+            else {
+                t = static_cast<int>(triangles.size());
+                triangles.push_back({ { a, b, c } });
+                neighbours.push_back({ { -1, -1, -1 } });
+                flags.push_back({ { 0, 0, 0 } });
+                alive.push_back(1);
+            }
+            vertexTriangle[a] = vertexTriangle[b] = vertexTriangle[c] = t;
+            created.push_back(t);
+            return t;
+        }
+
+        void removeTriangle(int t)
+        {
+            alive[t] = 0;
+            freeSlots.push_back(t);
+        }
+
+        int indexIn(int t, int v) const
+        {
+            return triangles[t][0] == v ? 0 : triangles[t][1] == v ? 1 : 2;
+        }
+
+        int indexOfNeighbour(int t, int n) const
+        {
+            return neighbours[t][0] == n ? 0 : neighbours[t][1] == n ? 1 : 2;
+        }
+
+        bool contains(int t, const Point<T>& p) const
+        {
+            auto const& v = triangles[t];
+            return orient(vertices[v[0]], vertices[v[1]], p) >= 0 && orient(vertices[v[1]], vertices[v[2]], p) >= 0 &&
+                orient(vertices[v[2]], vertices[v[0]], p) >= 0;
+        }
+
+        bool inCircle(int t, const Point<T>& p) const
+        {
+            auto const& a = vertices[triangles[t][0]];
+            auto const& b = vertices[triangles[t][1]];
+            auto const& c = vertices[triangles[t][2]];
+            return geometry::incircle(a.x, a.y, b.x, b.y, c.x, c.y, p.x, p.y) > 0;
+        }
+
+        bool onEdge(int t, int i, const Point<T>& p) const
+        {
+            auto const& a = vertices[triangles[t][(i + 1) % 3]];
+            auto const& b = vertices[triangles[t][(i + 2) % 3]];
+            return std::abs(orient(a, b, p)) <= tolerance * geometry::squaredDistance(a.x, a.y, b.x, b.y);
+        }
+
+        // True when v lies on the open segment ab.
+        bool collinear(int a, int b, int v) const
+        {
+            auto const& A = vertices[a];
+            auto const& B = vertices[b];
+            auto const& V = vertices[v];
+            const auto ab = geometry::squaredDistance(A.x, A.y, B.x, B.y);
+            const auto av = geometry::squaredDistance(A.x, A.y, V.x, V.y);
+            const auto o = orient(A, B, V);
+            const auto dot = (B.x - A.x) * (V.x - A.x) + (B.y - A.y) * (V.y - A.y);
+            return o * o <= tolerance * tolerance * ab * av && dot > 0 && av < ab;
+        }
+
+        // Calls visit(t, i) for the triangles around v, with v == triangles[t][i], until it returns true.
+        template <typename F>
+        bool aroundVertex(int v, F&& visit) const
+        {
+            const int start = vertexTriangle[v];
+            if (start < 0) {
+                return false;
+            }
+            int t = start;
+            do {
+                const int i = indexIn(t, v);
+                if (visit(t, i)) {
+                    return true;
+                }
+                t = neighbours[t][(i + 1) % 3];
+            } while (t >= 0 && t != start);
+            if (t == start) {
+                return false;
+            }
+            for (t = neighbours[start][(indexIn(start, v) + 2) % 3]; t >= 0; t = neighbours[t][(indexIn(t, v) + 2) % 3]) {
+                if (visit(t, indexIn(t, v))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void setTags(int t, int side, unsigned char tags)
+        {
+            flags[t][side] = tags;
+            const int n = neighbours[t][side];
+            if (n >= 0) {
+                flags[n][indexOfNeighbour(n, t)] = tags;
+            }
+        }
+
+        // Constraint bits accumulate; Boundary and Hole bits toggle, so each edge keeps the parity of
+        // the polygon edges lying on it.
+        void tagEdge(int t, int side, unsigned char tags)
+        {
+            if (t >= 0) {
+                setTags(t, side, static_cast<unsigned char>((flags[t][side] | (tags & Constraint)) ^ (tags & (Boundary | Hole))));
+            }
+        }
+
+        void addOuterSide(int c, int k)
+        {
+            const int a = triangles[c][(k + 1) % 3];
+            const int b = triangles[c][(k + 2) % 3];
+            const int n = neighbours[c][k];
+            sides.push_back({ std::min(a, b), std::max(a, b), n, n >= 0 ? indexOfNeighbour(n, c) : -1, true, flags[c][k] });
+        }
+
+        // Links the triangles in created to each other and to the outer sides collected in sides.
+        // A side left without a partner is a hull edge of an assigned mesh.
+        void stitch()
+        {
+            for (int t : created) {
+                for (int i = 0; i < 3; ++i) {
+                    const int a = triangles[t][(i + 1) % 3];
+                    const int b = triangles[t][(i + 2) % 3];
+                    sides.push_back({ std::min(a, b), std::max(a, b), t, i, false, 0 });
+                }
+            }
+            std::sort(sides.begin(), sides.end(), [](auto const& l, auto const& r) {
+                return l.lo < r.lo || (l.lo == r.lo && (l.hi < r.hi || (l.hi == r.hi && l.outer < r.outer)));
+            });
+            for (std::size_t k = 0; k < sides.size();) {
+                auto const& x = sides[k];
+                if (k + 1 < sides.size() && sides[k + 1].lo == x.lo && sides[k + 1].hi == x.hi) {
+                    auto const& y = sides[k + 1];
+                    neighbours[x.triangle][x.side] = y.triangle;
+                    flags[x.triangle][x.side] = y.tags;
+                    if (y.triangle >= 0) {
+                        neighbours[y.triangle][y.side] = x.triangle;
+                    }
+                    k += 2;
+                }
+                else {
+                    if (!x.outer) {
+                        flags[x.triangle][x.side] = Constraint;
+                    }
+                    k += 1;
+                }
+            }
+            sides.clear();
+        }
+
+        // Triangulates the pseudo-polygon a, chain[first..last), b by picking the chain vertex whose
+        // circle through a and b holds no other chain vertex.
+        void fillChain(int a, int b, const int* first, const int* last)
+        {
+            if (first == last) {
+                return;
+            }
+            auto const& A = vertices[a];
+            auto const& B = vertices[b];
+            auto c = first;
+            for (auto it = first + 1; it != last; ++it) {
+                auto const& C = vertices[*c];
+                auto const& P = vertices[*it];
+                const auto side = orient(A, B, C) > 0 ? 1 : -1;
+                if (side * geometry::incircle(A.x, A.y, B.x, B.y, C.x, C.y, P.x, P.y) > 0) {
+                    c = it;
+                }
+            }
+            addTriangle(a, b, *c);
+            fillChain(a, *c, first, c);
+            fillChain(*c, b, c + 1, last);
+        }
+
+        // A cavity side that becomes a fan triangle must see p strictly on its left.
+        bool visibleSides(int c, const Point<T>& p, int t, int side) const
+        {
+            for (int k = 0; k < 3; ++k) {
+                const int n = neighbours[c][k];
+                if ((n >= 0 && mark[n] == stamp) || (c == t && k == side)) {
+                    continue;
+                }
+                if (orient(vertices[triangles[c][(k + 1) % 3]], vertices[triangles[c][(k + 2) % 3]], p) <= 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Marks the triangles whose circumcircle holds p, grown from t (and its neighbour across side)
+        // without crossing a Constraint edge. Returns the number of seeds leading the cavity list.
+        std::size_t growCavity(const Point<T>& p, int t, int side)
+        {
+            nextStamp();
+            cavity.assign(1, t);
+            mark[t] = stamp;
+            if (side >= 0 && neighbours[t][side] >= 0) {
+                cavity.push_back(neighbours[t][side]);
+                mark[cavity.back()] = stamp;
+            }
+            const std::size_t seeds = cavity.size();
+            for (std::size_t k = 0; k < cavity.size(); ++k) {
+                const int c = cavity[k];
+                for (int i = 0; i < 3; ++i) {
+                    const int n = neighbours[c][i];
+                    if (n >= 0 && mark[n] != stamp && !(flags[c][i] & Constraint) && inCircle(n, p)) {
+                        mark[n] = stamp;
+                        cavity.push_back(n);
+                    }
+                }
+            }
+            return seeds;
+        }
+
+        int insertAt(const Point<T>& p, int t, int side)
+        {
+            int u = -1, v = -1;
+            unsigned char splitTags = 0;
+            if (side >= 0) {
+                u = triangles[t][(side + 1) % 3];
+                v = triangles[t][(side + 2) % 3];
+                splitTags = flags[t][side];
+            }
+            const std::size_t seeds = growCavity(p, t, side);
+            if (seeds == 2) {
+                side = -1;
+            }
+
+            // Rounding can break the star shape of the cavity; shrink it back to what p sees.
+            for (;;) {
+                for (std::size_t k = 0; k < seeds; ++k) {
+                    if (!visibleSides(cavity[k], p, t, side)) {
+                        return -1;
+                    }
+                }
+                bool shrunk = false;
+                for (std::size_t k = seeds; k < cavity.size(); ++k) {
+                    if (!visibleSides(cavity[k], p, t, side)) {
+                        mark[cavity[k]] = 0;
+                        shrunk = true;
+                    }
+                }
+                if (!shrunk) {
+                    break;
+                }
+                const unsigned previous = stamp;
+                nextStamp();
+                cavity.resize(seeds);
+                for (int c : cavity) {
+                    mark[c] = stamp;
+                }
+                for (std::size_t k = 0; k < cavity.size(); ++k) {
+                    const int c = cavity[k];
+                    for (int i = 0; i < 3; ++i) {
+                        const int n = neighbours[c][i];
+                        if (n >= 0 && mark[n] == previous && !(flags[c][i] & Constraint)) {
+                            mark[n] = stamp;
+                            cavity.push_back(n);
+                        }
+                    }
+                }
+            }
+
+            sides.clear();
+            fan.clear();
+            for (int c : cavity) {
+                for (int k = 0; k < 3; ++k) {
+                    const int n = neighbours[c][k];
+                    if ((n < 0 || mark[n] != stamp) && !(c == t && k == side)) {
+                        addOuterSide(c, k);
+                        fan.push_back({ { triangles[c][(k + 1) % 3], triangles[c][(k + 2) % 3] } });
+                        vertexMark[triangles[c][(k + 1) % 3]] = stamp;
+                        vertexMark[triangles[c][(k + 2) % 3]] = stamp;
+                    }
+                }
+            }
+            // Every cavity vertex must stay on its boundary, or it would drop out of the mesh.
+            for (int c : cavity) {
+                for (int w : triangles[c]) {
+                    if (vertexMark[w] != stamp) {
+                        sides.clear();
+                        return -1;
+                    }
+                }
+            }
+
+            const int id = static_cast<int>(vertices.size());
+            vertices.push_back(p);
+            vertexTriangle.push_back(-1);
+            for (int c : cavity) {
+                removeTriangle(c);
+            }
+            created.clear();
+            for (auto const& e : fan) {
+                addTriangle(e[0], e[1], id);
+            }
+            // Fan triangle k stands on outer side k, and its spoke (v, p) is shared with the fan
+            // triangle that starts at v, so the fan is linked without sorting its sides.
+            if (fanStart.size() < vertices.size()) {
+                fanStart.resize(vertices.size());
+            }
+            for (auto const& e : fan) {
+                fanStart[e[1]] = -1;
+            }
+            for (std::size_t k = 0; k < fan.size(); ++k) {
+                fanStart[fan[k][0]] = created[k];
+            }
+            for (std::size_t k = 0; k < fan.size(); ++k) {
+                const int f = created[k];
+                auto const& outer = sides[k];
+                neighbours[f][2] = outer.triangle;
+                flags[f][2] = outer.tags;
+                if (outer.triangle >= 0) {
+                    neighbours[outer.triangle][outer.side] = f;
+                }
+                const int g = fanStart[fan[k][1]];
+                if (g >= 0) {
+                    neighbours[f][0] = g;
+                    neighbours[g][1] = f;
+                }
+            }
+            sides.clear();
+            if (u >= 0 && splitTags) {
+                for (int w : { u, v }) {
+                    int s = -1;
+                    const int f = findEdge(id, w, s);
+                    if (f >= 0) {
+                        setTags(f, s, splitTags);
+                    }
+                }
+            }
+            recent = created.back();
+            return id;
+        }
+
+        std::vector<int> freeSlots;
+        std::vector<int> cavity;
+        std::vector<int> crossing;
+        std::vector<int> lower;
+        std::vector<int> upper;
+        std::vector<std::array<int, 2>> fan;
+        std::vector<std::array<int, 2>> flipStack;
+        std::vector<int> fanStart;
+        std::vector<Side> sides;
+        std::vector<unsigned> mark;
+        std::vector<unsigned> vertexMark;
+        unsigned stamp = 0;
+        int superCount = 0;
+        int recent = -1;
+    };
+
+    template <typename T>
+    struct Constraints {
+        std::vector<Edge<T>> segments;
+        std::vector<std::vector<Point<T>>> boundaries;
+        std::vector<std::vector<Point<T>>> holes;
+    };
+
+    // Delaunay triangulation of points with every constraint segment and polygon edge present.
+    // Segments crossing each other are split at their intersection. Triangles inside a hole, or
+    // outside all boundaries when any are given, are dropped (even-odd rule, by a flood fill that
+    // toggles its parity on polygon edges).
+    template <
+        typename T,
+        typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
+    void triangulateConstrained(const std::vector<Point<T>>& points, const Constraints<T>& constraints, Delaunay<T>& d, Workspace<T>& ws)
+    {
+        using Tags = IncrementalMesh<T>;
+        struct Segment {
+            Point<T> a, b;
+            unsigned char tags;
+        };
+        std::vector<Segment> segments;
+        for (auto const& e : constraints.segments) {
+            segments.push_back({ e.p0, e.p1, Tags::Constraint });
+        }
+        for (auto const* polygons : { &constraints.boundaries, &constraints.holes }) {
+            const unsigned char tags = Tags::Constraint | (polygons == &constraints.holes ? Tags::Hole : Tags::Boundary);
+            for (auto const& polygon : *polygons) {
+                for (std::size_t i = 0; i < polygon.size(); ++i) {
+                    segments.push_back({ polygon[i], polygon[(i + 1) % polygon.size()], tags });
+                }
+            }
+        }
+
+        std::vector<Point<T>> nodes(points);
+        for (auto const& s : segments) {
+            nodes.push_back(s.a);
+            nodes.push_back(s.b);
+        }
+        std::sort(nodes.begin(), nodes.end(), lessPoint<T>);
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        d.triangles.clear();
+        d.edges.clear();
+        if (nodes.size() < 3) {
+            return;
+        }
+
+        auto& mesh = ws.incremental;
+        auto xmin = nodes[0].x, xmax = xmin, ymin = nodes[0].y, ymax = ymin;
+        for (auto const& p : nodes) {
+            xmin = std::min(xmin, p.x);
+            xmax = std::max(xmax, p.x);
+            ymin = std::min(ymin, p.y);
+            ymax = std::max(ymax, p.y);
+        }
+        mesh.reset(xmin, ymin, xmax, ymax);
+        hilbertOrder(nodes, ws.order);
+        ws.ids.assign(nodes.size(), -1);
+        for (int i : ws.order) {
+            ws.ids[i] = mesh.insert(nodes[i]);
+        }
+        auto idOf = [&](const Point<T>& p) {
+            return ws.ids[std::lower_bound(nodes.begin(), nodes.end(), p, lessPoint<T>) - nodes.begin()];
+        };
+        for (auto const& s : segments) {
+            const int a = idOf(s.a);
+            const int b = idOf(s.b);
+            if (a >= 0 && b >= 0) {
+                mesh.insertSegment(a, b, s.tags);
+            }
+        }
+
+        // Flood from the super-triangle fan; the parity bits of a triangle say whether it lies inside
+        // an odd number of boundary and hole polygons.
+        const auto count = mesh.triangles.size();
+        const auto super = static_cast<int>(mesh.superVertices());
+        std::vector<char> parity(count, -1);
+        ws.ids.clear();
+        for (std::size_t t = 0; t < count; ++t) {
+            auto const& v = mesh.triangles[t];
+            if (mesh.alive[t] && (v[0] < super || v[1] < super || v[2] < super)) {
+                parity[t] = 0;
+                ws.ids.push_back(static_cast<int>(t));
+            }
+        }
+        for (std::size_t k = 0; k < ws.ids.size(); ++k) {
+            const int t = ws.ids[k];
+            for (int i = 0; i < 3; ++i) {
+                const int n = mesh.neighbours[t][i];
+                if (n >= 0 && parity[n] < 0) {
+                    parity[n] = static_cast<char>(parity[t] ^ (mesh.flags[t][i] & (Tags::Boundary | Tags::Hole)));
+                    ws.ids.push_back(n);
+                }
+            }
+        }
+        std::vector<char> keep(count, 0);
+        for (std::size_t t = 0; t < count; ++t) {
+            keep[t] = parity[t] >= 0 && !(parity[t] & Tags::Hole) && (constraints.boundaries.empty() || (parity[t] & Tags::Boundary));
+        }
+        mesh.exportTo(d, &keep);
+    }
+
+    template <
+        typename T,
+        typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
+    Delaunay<T> triangulateConstrained(const std::vector<Point<T>>& points, const Constraints<T>& constraints)
+    {
+        static thread_local Workspace<T> workspace;
+        auto d = Delaunay<T>{};
+        triangulateConstrained(points, constraints, d, workspace);
+        return d;
+    }
+
+    template <typename T>
+    struct RefineOptions {
+        T minAngle = 20;
+        T maxArea = 0;
+        std::size_t maxSteinerPoints = 10000000;
+    };
+
+    // Ruppert-style refinement: circumcentres of triangles below minAngle (degrees) or above maxArea
+    // are inserted into the mesh. Mesh boundary edges (outer hull and holes) and every constraint
+    // segment and polygon edge act as segments. A segment is split at its midpoint when a vertex lies
+    // in its diametral circle, or when a circumcentre would. Cavities are grown from the triangle
+    // holding the new point and stop at segments, so nothing is inserted across a boundary.
+    template <
+        typename T,
+        typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
+    void refine(Delaunay<T>& d, const Constraints<T>& constraints, const RefineOptions<T>& options, Workspace<T>& ws)
+    {
+        if (d.triangles.empty()) {
+            return;
+        }
+
+        auto& mesh = ws.incremental;
+        using Tags = IncrementalMesh<T>;
+        mesh.assign(d);
+        auto insertConstraint = [&](const Point<T>& a, const Point<T>& b) {
+            const int u = mesh.insert(a);
+            const int v = mesh.insert(b);
+            if (u >= 0 && v >= 0) {
+                mesh.insertSegment(u, v);
+            }
+        };
+        for (auto const& e : constraints.segments) {
+            insertConstraint(e.p0, e.p1);
+        }
+        for (auto const* polygons : { &constraints.boundaries, &constraints.holes }) {
+            for (auto const& polygon : *polygons) {
+                for (std::size_t i = 0; i < polygon.size(); ++i) {
+                    insertConstraint(polygon[i], polygon[(i + 1) % polygon.size()]);
+                }
+            }
+        }
+        mesh.makeDelaunay();
+
+        auto xmin = mesh.vertices[0].x, xmax = xmin, ymin = mesh.vertices[0].y, ymax = ymin;
+        for (auto const& p : mesh.vertices) {
+            xmin = std::min(xmin, p.x);
+            xmax = std::max(xmax, p.x);
+            ymin = std::min(ymin, p.y);
+            ymax = std::max(ymax, p.y);
+        }
+        const auto diagonal = (xmax - xmin) * (xmax - xmin) + (ymax - ymin) * (ymax - ymin);
+        const auto minEdge = diagonal * static_cast<T>(1e-12);
+        const auto sinMin = std::sin(options.minAngle * static_cast<T>(3.14159265358979323846) / 180);
+        const auto ratioBound = 1 / (4 * sinMin * sinMin);
+
+        // Triangle slots are reused, so queue entries carry their vertices and are checked on pop.
+        struct Bad {
+            T badness;
+            int triangle;
+            std::array<int, 3> vertices;
+            bool operator<(const Bad& other) const { return badness < other.badness; }
+        };
+        std::priority_queue<Bad> queue;
+        std::vector<std::array<int, 2>> encroached;
+
+        auto length2 = [&](int a, int b) {
+            auto const& p = mesh.vertices[a];
+            auto const& q = mesh.vertices[b];
+            return (q.x - p.x) * (q.x - p.x) + (q.y - p.y) * (q.y - p.y);
+        };
+        // Ruppert only needs the apex on either side: it is the vertex nearest the segment's midpoint.
+        auto checkSegment = [&](int t, int i) {
+            const int a = mesh.triangles[t][(i + 1) % 3];
+            const int b = mesh.triangles[t][(i + 2) % 3];
+            for (int s : { t, mesh.neighbours[t][i] }) {
+                if (s < 0) {
+                    continue;
+                }
+                int apex = mesh.triangles[s][0] != a && mesh.triangles[s][0] != b ? mesh.triangles[s][0] :
+                    mesh.triangles[s][1] != a && mesh.triangles[s][1] != b ? mesh.triangles[s][1] : mesh.triangles[s][2];
+                auto const& p = mesh.vertices[apex];
+                auto const& A = mesh.vertices[a];
+                auto const& B = mesh.vertices[b];
+                if ((A.x - p.x) * (B.x - p.x) + (A.y - p.y) * (B.y - p.y) < 0) {
+                    encroached.push_back({ { a, b } });
+                    return;
+                }
+            }
+        };
+        auto checkTriangle = [&](int t) {
+            auto const& v = mesh.triangles[t];
+            const auto shortest = std::min({ length2(v[0], v[1]), length2(v[1], v[2]), length2(v[2], v[0]) });
+            if (shortest <= minEdge) {
+                return;
+            }
+            auto const& a = mesh.vertices[v[0]];
+            auto const& b = mesh.vertices[v[1]];
+            auto const& c = mesh.vertices[v[2]];
+            const auto area = orient(a, b, c) / 2;
+            const auto circumradius = length2(v[0], v[1]) * length2(v[1], v[2]) * length2(v[2], v[0]) / (16 * area * area);
+            T badness = options.minAngle > 0 ? circumradius / shortest / ratioBound : 0;
+            if (options.maxArea > 0) {
+                badness = std::max(badness, area / options.maxArea);
+            }
+            if (badness > 1) {
+                queue.push({ badness, t, v });
+            }
+        };
+        auto checkCreated = [&]() {
+            for (int t : mesh.created) {
+                checkTriangle(t);
+                for (int i = 0; i < 3; ++i) {
+                    if (mesh.flags[t][i] & Tags::Constraint) {
+                        checkSegment(t, i);
+                    }
+                }
+            }
+        };
+
+        for (std::size_t t = 0; t < mesh.triangles.size(); ++t) {
+            if (!mesh.alive[t]) {
+                continue;
+            }
+            checkTriangle(static_cast<int>(t));
+            for (int i = 0; i < 3; ++i) {
+                const int n = mesh.neighbours[t][i];
+                if ((mesh.flags[t][i] & Tags::Constraint) && (n < 0 || n < static_cast<int>(t))) {
+                    checkSegment(static_cast<int>(t), i);
+                }
+            }
+        }
+
+        std::size_t steiner = 0;
+        auto splitSegment = [&](int a, int b) {
+            int side = -1;
+            const int t = mesh.findEdge(a, b, side);
+            if (t < 0 || !(mesh.flags[t][side] & Tags::Constraint) || length2(a, b) <= 4 * minEdge) {
+                return false;
+            }
+            auto const& A = mesh.vertices[a];
+            auto const& B = mesh.vertices[b];
+            if (mesh.split(t, side, Point<T>{ (A.x + B.x) / 2, (A.y + B.y) / 2 }) < 0) {
+                return false;
+            }
+            ++steiner;
+            checkCreated();
+            return true;
+        };
+        auto splitEncroached = [&]() {
+            while (!encroached.empty() && steiner < options.maxSteinerPoints) {
+                const auto e = encroached.back();
+                encroached.pop_back();
+                splitSegment(e[0], e[1]);
+            }
+            encroached.clear();
+        };
+
+        splitEncroached();
+        while (!queue.empty() && steiner < options.maxSteinerPoints) {
+            const auto top = queue.top();
+            queue.pop();
+            if (!mesh.alive[top.triangle] || mesh.triangles[top.triangle] != top.vertices) {
+                continue;
+            }
+            auto const& a = mesh.vertices[top.vertices[0]];
+            auto const& b = mesh.vertices[top.vertices[1]];
+            auto const& c = mesh.vertices[top.vertices[2]];
+            const auto circle = Triangle<T>{ a, b, c }.circle;
+            const Point<T> centre{ circle.x, circle.y };
+
+            // A circumcentre behind a segment, or inside a segment's diametral circle, splits that
+            // segment instead; the triangle is retried if it survives.
+            int barrier = -1;
+            const int t = mesh.locate(centre, top.triangle, &barrier);
+            if (t >= 0) {
+                barrier = mesh.encroached(centre, t);
+            }
+            if (barrier >= 0) {
+                const int bt = barrier / 3;
+                const int bi = barrier % 3;
+                if (splitSegment(mesh.triangles[bt][(bi + 1) % 3], mesh.triangles[bt][(bi + 2) % 3])) {
+                    splitEncroached();
+                    queue.push(top);
+                }
+                continue;
+            }
+            if (t >= 0 && mesh.insert(centre, t) >= 0) {
+                ++steiner;
+                checkCreated();
+                splitEncroached();
+            }
+        }
+
+        mesh.exportTo(d);
+    }
+
+    template <
+        typename T,
+        typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
+    void refine(Delaunay<T>& d, const Constraints<T>& constraints, const RefineOptions<T>& options)
+    {
+        static thread_local Workspace<T> workspace;
+        refine(d, constraints, options, workspace);
+    }
+
+    template <
+        typename T,
+        typename = typename std::enable_if<std::is_floating_point<T>::value>::type>
+    void refine(Delaunay<T>& d, const RefineOptions<T>& options)
+    {
+        refine(d, Constraints<T>{}, options);
+    }
+
+    // Indexed form of a Delaunay triangle list: triangles[t] matches d.triangles[t], stored counter-clockwise.
+    // neighbours[t][i] is the triangle across the edge opposite vertex i, or -1 on the hull.
+    template <typename T>
+    struct Mesh {
+        std::vector<Point<T>> vertices;
+        std::vector<std::array<int, 3>> triangles;
+        std::vector<std::array<int, 3>> neighbours;
+        std::vector<int> vertexTriangle;
+        std::vector<int> adjacencyOffsets;
+        std::vector<int> adjacency;
+    };
+
+    template <typename T>
+    Mesh<T> buildMesh(const Delaunay<T>& d)
+    {
+        Mesh<T> mesh;
+        for (auto const& tri : d.triangles) {
+            mesh.vertices.push_back(tri.p0);
+            mesh.vertices.push_back(tri.p1);
+            mesh.vertices.push_back(tri.p2);
+        }
+        std::sort(mesh.vertices.begin(), mesh.vertices.end(), lessPoint<T>);
+        mesh.vertices.erase(std::unique(mesh.vertices.begin(), mesh.vertices.end()), mesh.vertices.end());
+
+        auto indexOf = [&](const Point<T>& p) {
+            return static_cast<int>(std::lower_bound(mesh.vertices.begin(), mesh.vertices.end(), p, lessPoint<T>) - mesh.vertices.begin());
+        };
+
+        struct HalfEdge {
+            int a, b, triangle, side;
+        };
+        std::vector<HalfEdge> halfEdges;
+        halfEdges.reserve(3 * d.triangles.size());
+        mesh.vertexTriangle.assign(mesh.vertices.size(), -1);
+        mesh.triangles.reserve(d.triangles.size());
+        for (auto const& tri : d.triangles) {
+            std::array<int, 3> v{ { indexOf(tri.p0), indexOf(tri.p1), indexOf(tri.p2) } };
+            if (orient(tri.p0, tri.p1, tri.p2) < 0) {
+                std::swap(v[1], v[2]);
+            }
+            const int t = static_cast<int>(mesh.triangles.size());
+            mesh.triangles.push_back(v);
+            for (int i = 0; i < 3; ++i) {
+                mesh.vertexTriangle[v[i]] = t;
+                const int a = v[(i + 1) % 3];
+                const int b = v[(i + 2) % 3];
+                halfEdges.push_back({ std::min(a, b), std::max(a, b), t, i });
+            }
+        }
+        std::sort(halfEdges.begin(), halfEdges.end(), [](auto const& l, auto const& r) {
+            return l.a < r.a || (l.a == r.a && l.b < r.b);
+        });
+
+        mesh.neighbours.assign(mesh.triangles.size(), { { -1, -1, -1 } });
+        std::vector<int> degree(mesh.vertices.size(), 0);
+        std::vector<std::pair<int, int>> links;
+        for (std::size_t i = 0; i < halfEdges.size();) {
+            std::size_t j = i + 1;
+            while (j < halfEdges.size() && halfEdges[j].a == halfEdges[i].a && halfEdges[j].b == halfEdges[i].b) {
+                ++j;
+            }
+            if (j - i == 2) {
+                mesh.neighbours[halfEdges[i].triangle][halfEdges[i].side] = halfEdges[i + 1].triangle;
+                mesh.neighbours[halfEdges[i + 1].triangle][halfEdges[i + 1].side] = halfEdges[i].triangle;
+            }
+            links.emplace_back(halfEdges[i].a, halfEdges[i].b);
+            ++degree[halfEdges[i].a];
+            ++degree[halfEdges[i].b];
+            i = j;
+        }
+
+        mesh.adjacencyOffsets.assign(mesh.vertices.size() + 1, 0);
+        for (std::size_t v = 0; v < mesh.vertices.size(); ++v) {
+            mesh.adjacencyOffsets[v + 1] = mesh.adjacencyOffsets[v] + degree[v];
+        }
+        mesh.adjacency.resize(mesh.adjacencyOffsets.back());
+        std::vector<int> fill(mesh.adjacencyOffsets.begin(), mesh.adjacencyOffsets.end() - 1);
+        for (auto const& link : links) {
+            mesh.adjacency[fill[link.first]++] = link.second;
+            mesh.adjacency[fill[link.second]++] = link.first;
+        }
+        return mesh;
+    }
+
+    // Finite Voronoi edges: the circumcentres of every pair of triangles sharing an edge.
+    template <typename T>
+    void voronoiEdges(const Delaunay<T>& d, const Mesh<T>& mesh, std::vector<Edge<T>>& out)
+    {
+        out.clear();
+        for (std::size_t t = 0; t < mesh.neighbours.size(); ++t) {
+            for (int n : mesh.neighbours[t]) {
+                if (n > static_cast<int>(t)) {
+                    auto const& a = d.triangles[t].circle;
+                    auto const& b = d.triangles[n].circle;
+                    out.emplace_back(Point<T>{ a.x, a.y }, Point<T>{ b.x, b.y });
+                }
+            }
+        }
+    }
+
+    template <typename It, typename Compare>
+    void parallelSort(It first, It last, Compare less, unsigned threads = 0)
+    {
+        const auto n = static_cast<std::size_t>(last - first);
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (threads == 1 || n < (1u << 16)) {
+            std::sort(first, last, less);
+            return;
+        }
+
+        const std::size_t chunks = threads;
+        std::vector<std::size_t> bounds(chunks + 1);
+        for (std::size_t i = 0; i <= chunks; ++i) {
+            bounds[i] = n * i / chunks;
+        }
+        parallelFor(chunks, threads, [&](std::size_t i, unsigned) {
+            std::sort(first + bounds[i], first + bounds[i + 1], less);
+        });
+        for (std::size_t width = 1; width < chunks; width *= 2) {
+            parallelFor((chunks + 2 * width - 1) / (2 * width), threads, [&](std::size_t k, unsigned) {
+                const std::size_t lo = 2 * width * k;
+                const std::size_t mid = std::min(lo + width, chunks);
+                const std::size_t hi = std::min(lo + 2 * width, chunks);
+                if (mid < hi) {
+                    std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi], less);
+                }
+            });
+        }
+    }
+
+    class DisjointSets {
+    public:
+        explicit DisjointSets(std::size_t count) : parent(count), rank(count, 0)
+        {
+            for (std::size_t i = 0; i < count; ++i) {
+                parent[i] = static_cast<int>(i);
+            }
+        }
+
+        int find(int v)
+        {
+            while (parent[v] != v) {
+                parent[v] = parent[parent[v]];
+                v = parent[v];
+            }
+            return v;
+        }
+
+        bool unite(int a, int b)
+        {
+            a = find(a);
+            b = find(b);
+            if (a == b) {
+                return false;
+            }
+            if (rank[a] < rank[b]) {
+                std::swap(a, b);
+            }
+            parent[b] = a;
+            if (rank[a] == rank[b]) {
+                ++rank[a];
+            }
+            return true;
+        }
+
+    private:
+        std::vector<int> parent;
+        std::vector<int> rank;
+    };
+
+    using GraphEdge = std::pair<int, int>;
+
+    template <typename T>
+    T squaredLength(const Mesh<T>& mesh, int a, int b)
+    {
+        auto const& p = mesh.vertices[a];
+        auto const& q = mesh.vertices[b];
+        return geometry::squaredDistance(p.x, p.y, q.x, q.y);
+    }
+
+    template <typename T>
+    void delaunayGraph(const Mesh<T>& mesh, std::vector<GraphEdge>& out)
+    {
+        out.clear();
+        out.reserve(mesh.adjacency.size() / 2);
+        for (std::size_t v = 0; v < mesh.vertices.size(); ++v) {
+            for (int k = mesh.adjacencyOffsets[v]; k < mesh.adjacencyOffsets[v + 1]; ++k) {
+                if (mesh.adjacency[k] > static_cast<int>(v)) {
+                    out.emplace_back(static_cast<int>(v), mesh.adjacency[k]);
+                }
+            }
+        }
+    }
+
+    // The Euclidean MST is a subgraph of the Delaunay graph, so Kruskal only has to sort its ~3n edges.
+    template <typename T>
+    void minimumSpanningTree(const Mesh<T>& mesh, std::vector<GraphEdge>& out, unsigned threads = 0)
+    {
+        struct Weighted {
+            T weight;
+            int a, b;
+        };
+        std::vector<Weighted> edges;
+        edges.reserve(mesh.adjacency.size() / 2);
+        for (std::size_t v = 0; v < mesh.vertices.size(); ++v) {
+            for (int k = mesh.adjacencyOffsets[v]; k < mesh.adjacencyOffsets[v + 1]; ++k) {
+                const int u = mesh.adjacency[k];
+                if (u > static_cast<int>(v)) {
+                    edges.push_back({ squaredLength(mesh, static_cast<int>(v), u), static_cast<int>(v), u });
+                }
+            }
+        }
+        parallelSort(edges.begin(), edges.end(), [](auto const& l, auto const& r) { return l.weight < r.weight; }, threads);
+
+        out.clear();
+        DisjointSets sets(mesh.vertices.size());
+        for (auto const& e : edges) {
+            if (sets.unite(e.a, e.b)) {
+                out.emplace_back(e.a, e.b);
+                if (out.size() + 1 == mesh.vertices.size()) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // A Delaunay edge is Gabriel when neither opposite vertex of its two triangles lies inside its diametral circle.
+    template <typename T>
+    void gabrielGraph(const Mesh<T>& mesh, std::vector<GraphEdge>& out)
+    {
+        auto encroaches = [&](int c, int a, int b) {
+            auto const& p = mesh.vertices[c];
+            auto const& q = mesh.vertices[a];
+            auto const& r = mesh.vertices[b];
+            return (q.x - p.x) * (r.x - p.x) + (q.y - p.y) * (r.y - p.y) < 0;
+        };
+
+        out.clear();
+        for (std::size_t t = 0; t < mesh.triangles.size(); ++t) {
+            auto const& v = mesh.triangles[t];
+            for (int i = 0; i < 3; ++i) {
+                const int n = mesh.neighbours[t][i];
+                if (n >= 0 && n < static_cast<int>(t)) {
+                    continue;
+                }
+                const int a = v[(i + 1) % 3];
+                const int b = v[(i + 2) % 3];
+                bool gabriel = !encroaches(v[i], a, b);
+                if (gabriel && n >= 0) {
+                    for (int j = 0; j < 3; ++j) {
+                        if (mesh.neighbours[n][j] == static_cast<int>(t)) {
+                            gabriel = !encroaches(mesh.triangles[n][j], a, b);
+                        }
+                    }
+                }
+                if (gabriel) {
+                    out.emplace_back(std::min(a, b), std::max(a, b));
+                }
+            }
+        }
+    }
+
+    // Uniform bucket grid over a fixed point set, stored as compressed rows: the points of cell c are
+    // sites[offsets[c] .. offsets[c + 1]). Cells hold about one point each.
+    template <typename T>
+    struct PointGrid {
+        T x0{}, y0{}, width{ 1 }, height{ 1 };
+        int cols{ 1 }, rows{ 1 };
+        std::vector<int> offsets{ 0, 0 };
+        std::vector<int> sites;
+
+        void build(const std::vector<Point<T>>& points)
+        {
+            if (points.empty()) {
+                *this = PointGrid{};
+                return;
+            }
+            T xmax = points[0].x, ymax = points[0].y;
+            x0 = xmax;
+            y0 = ymax;
+            for (auto const& p : points) {
+                x0 = std::min(x0, p.x);
+                xmax = std::max(xmax, p.x);
+                y0 = std::min(y0, p.y);
+                ymax = std::max(ymax, p.y);
+            }
+            width = std::max<T>(xmax - x0, eps);
+            height = std::max<T>(ymax - y0, eps);
+            const auto cell = std::sqrt(width * height / static_cast<T>(points.size()));
+            cols = std::max(1, std::min(1 << 14, static_cast<int>(width / cell) + 1));
+            rows = std::max(1, std::min(1 << 14, static_cast<int>(height / cell) + 1));
+
+            offsets.assign(static_cast<std::size_t>(cols) * rows + 1, 0);
+            sites.resize(points.size());
+            for (auto const& p : points) {
+                ++offsets[cellOf(p) + 1];
+            }
+            for (std::size_t c = 1; c < offsets.size(); ++c) {
+                offsets[c] += offsets[c - 1];
+            }
+            std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < points.size(); ++i) {
+                sites[fill[cellOf(points[i])]++] = static_cast<int>(i);
+            }
+        }
+
+        int col(T x) const { return std::max(0, std::min(cols - 1, static_cast<int>((x - x0) / width * cols))); }
+        int row(T y) const { return std::max(0, std::min(rows - 1, static_cast<int>((y - y0) / height * rows))); }
+        std::size_t cellOf(const Point<T>& p) const { return static_cast<std::size_t>(row(p.y)) * cols + col(p.x); }
+
+        // Calls visit(site) for the points in the cells overlapping the box until it returns true.
+        template <typename F>
+        bool visit(T xmin, T ymin, T xmax, T ymax, F&& f) const
+        {
+            const int c0 = col(xmin), c1 = col(xmax), r0 = row(ymin), r1 = row(ymax);
+            for (int r = r0; r <= r1; ++r) {
+                const std::size_t base = static_cast<std::size_t>(r) * cols;
+                for (int k = offsets[base + c0]; k < offsets[base + c1 + 1]; ++k) {
+                    if (f(sites[k])) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+    };
+
+    // RNG edges are the Gabriel edges whose lune holds no other site. The lune is searched through a
+    // bucket grid of about one site per cell, so short edges only touch a handful of cells.
+    template <typename T>
+    void relativeNeighbourhoodGraph(const Mesh<T>& mesh, std::vector<GraphEdge>& out, unsigned threads = 0)
+    {
+        std::vector<GraphEdge> candidates;
+        gabrielGraph(mesh, candidates);
+        out.clear();
+        if (mesh.vertices.empty()) {
+            return;
+        }
+
+        PointGrid<T> grid;
+        grid.build(mesh.vertices);
+
+        std::vector<char> keep(candidates.size(), 0);
+        parallelFor(candidates.size(), threads, [&](std::size_t i, unsigned) {
+            const int a = candidates[i].first;
+            const int b = candidates[i].second;
+            auto const& p = mesh.vertices[a];
+            auto const& q = mesh.vertices[b];
+            const auto length = squaredLength(mesh, a, b);
+            // Bounding box of the lune: half the edge along it, sqrt(3)/2 of the edge across it.
+            const auto mx = (p.x + q.x) / 2, my = (p.y + q.y) / 2;
+            const auto rx = std::abs(q.x - p.x) / 2 + std::abs(q.y - p.y) / 2 * static_cast<T>(1.7320508075688772);
+            const auto ry = std::abs(q.y - p.y) / 2 + std::abs(q.x - p.x) / 2 * static_cast<T>(1.7320508075688772);
+            const bool blocked = grid.visit(mx - rx, my - ry, mx + rx, my + ry, [&](int s) {
+                return s != a && s != b && squaredLength(mesh, a, s) < length && squaredLength(mesh, b, s) < length;
+            });
+            keep[i] = blocked ? 0 : 1;
+        });
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            if (keep[i]) {
+                out.push_back(candidates[i]);
+            }
+        }
+    }
+
+    // Alpha shapes for any alpha from one sort of the triangles by their cached circumradius:
+    // the shape for alpha keeps the triangles with radius <= alpha, a prefix of that order.
+    // The mesh is referenced, not copied, and must outlive the shape; temporaries are rejected.
+    template <typename T>
+    class AlphaShape {
+    public:
+        AlphaShape(const Delaunay<T>& d, const Mesh<T>& mesh) : mesh(&mesh), order(d.triangles.size()), rank(d.triangles.size())
+        {
+            for (std::size_t t = 0; t < order.size(); ++t) {
+                order[t] = static_cast<int>(t);
+            }
+            std::sort(order.begin(), order.end(), [&](int l, int r) { return d.triangles[l].circle.radius < d.triangles[r].circle.radius; });
+            radii.reserve(order.size());
+            for (std::size_t i = 0; i < order.size(); ++i) {
+                rank[order[i]] = static_cast<int>(i);
+                radii.push_back(d.triangles[order[i]].circle.radius);
+            }
+        }
+
+        AlphaShape(const Delaunay<T>& d, Mesh<T>&& mesh) = delete;
+
+        std::size_t count(T alpha) const
+        {
+            return std::upper_bound(radii.begin(), radii.end(), alpha * alpha) - radii.begin();
+        }
+
+        void triangles(T alpha, std::vector<int>& out) const
+        {
+            out.assign(order.begin(), order.begin() + count(alpha));
+        }
+
+        void boundary(T alpha, std::vector<GraphEdge>& out) const
+        {
+            out.clear();
+            const int kept = static_cast<int>(count(alpha));
+            for (int i = 0; i < kept; ++i) {
+                const int t = order[i];
+                auto const& v = mesh->triangles[t];
+                for (int side = 0; side < 3; ++side) {
+                    const int n = mesh->neighbours[t][side];
+                    if (n < 0 || rank[n] >= kept) {
+                        out.emplace_back(v[(side + 1) % 3], v[(side + 2) % 3]);
+                    }
+                }
+            }
+        }
+
+    private:
+        const Mesh<T>* mesh;
+        std::vector<int> order;
+        std::vector<int> rank;
+        std::vector<T> radii;
+    };
+
+    // Read-only point location and proximity queries over a triangulation; all queries are const and
+    // may run concurrently. Triangle results index d.triangles, site results index mesh().vertices.
+    template <typename T>
+    class SpatialIndex {
+    public:
+        explicit SpatialIndex(const Delaunay<T>& d) : meshData(buildMesh(d))
+        {
+            const auto n = meshData.vertices.size();
+            const auto count = std::max<std::size_t>(1, static_cast<std::size_t>(std::cbrt(static_cast<double>(n))));
+            std::vector<int> order(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                order[i] = static_cast<int>(i);
+            }
+            std::shuffle(order.begin(), order.end(), std::mt19937(12345));
+            samples.assign(order.begin(), order.begin() + std::min(count, n));
+            grid.build(meshData.vertices);
+        }
+
+        const Mesh<T>& mesh() const { return meshData; }
+
+        int locate(const Point<T>& p) const
+        {
+            const int start = nearestSample(p);
+            if (start < 0) {
+                return -1;
+            }
+            int t = meshData.vertexTriangle[start];
+            for (std::size_t step = 0; step <= meshData.triangles.size() && t >= 0; ++step) {
+                auto const& v = meshData.triangles[t];
+                int next = -1;
+                bool inside = true;
+                for (int k = 0; k < 3 && next < 0; ++k) {
+                    const int i = static_cast<int>((k + step) % 3);
+                    auto const& a = meshData.vertices[v[(i + 1) % 3]];
+                    auto const& b = meshData.vertices[v[(i + 2) % 3]];
+                    if (orient(a, b, p) < 0) {
+                        inside = false;
+                        next = meshData.neighbours[t][i];
+                    }
+                }
+                if (inside) {
+                    return t;
+                }
+                t = next;
+            }
+            return -1;
+        }
+
+        int nearest(const Point<T>& p) const
+        {
+            int v = nearestSample(p);
+            if (v < 0) {
+                return -1;
+            }
+            auto best = distance(v, p);
+            for (bool moved = true; moved;) {
+                moved = false;
+                for (int k = meshData.adjacencyOffsets[v]; k < meshData.adjacencyOffsets[v + 1]; ++k) {
+                    const int u = meshData.adjacency[k];
+                    const auto dist = distance(u, p);
+                    if (dist < best) {
+                        best = dist;
+                        v = u;
+                        moved = true;
+                    }
+                }
+            }
+            return v;
+        }
+
+        // The (i + 1)-th nearest site is a Delaunay neighbour of one of the first i, so a best-first
+        // expansion over the graph from the nearest site visits them in order.
+        void nearest(const Point<T>& p, std::size_t k, std::vector<int>& out) const
+        {
+            out.clear();
+            const int first = nearest(p);
+            if (first < 0 || k == 0) {
+                return;
+            }
+            using Entry = std::pair<T, int>;
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> frontier;
+            std::unordered_set<int> seen;
+            seen.reserve(8 * k);
+            seen.insert(first);
+            frontier.push({ distance(first, p), first });
+            while (!frontier.empty() && out.size() < k) {
+                const int v = frontier.top().second;
+                frontier.pop();
+                out.push_back(v);
+                for (int j = meshData.adjacencyOffsets[v]; j < meshData.adjacencyOffsets[v + 1]; ++j) {
+                    const int u = meshData.adjacency[j];
+                    if (seen.insert(u).second) {
+                        frontier.push({ distance(u, p), u });
+                    }
+                }
+            }
+        }
+
+        void range(T xmin, T ymin, T xmax, T ymax, std::vector<int>& out) const
+        {
+            out.clear();
+            grid.visit(xmin, ymin, xmax, ymax, [&](int v) {
+                auto const& q = meshData.vertices[v];
+                if (q.x >= xmin && q.x <= xmax && q.y >= ymin && q.y <= ymax) {
+                    out.push_back(v);
+                }
+                return false;
+            });
+        }
+
+        void locate(const std::vector<Point<T>>& queries, std::vector<int>& out, unsigned threads = 0) const
+        {
+            out.resize(queries.size());
+            parallelFor(queries.size(), threads, [&](std::size_t i, unsigned) { out[i] = locate(queries[i]); });
+        }
+
+        void nearest(const std::vector<Point<T>>& queries, std::vector<int>& out, unsigned threads = 0) const
+        {
+            out.resize(queries.size());
+            parallelFor(queries.size(), threads, [&](std::size_t i, unsigned) { out[i] = nearest(queries[i]); });
+        }
+
+    private:
+        T distance(int v, const Point<T>& p) const
+        {
+            const auto& q = meshData.vertices[v];
+            return geometry::squaredDistance(q.x, q.y, p.x, p.y);
+        }
+
+        int nearestSample(const Point<T>& p) const
+        {
+            int best = -1;
+            T bestDist = 0;
+            for (int v : samples) {
+                const auto dist = distance(v, p);
+                if (best < 0 || dist < bestDist) {
+                    best = v;
+                    bestDist = dist;
+                }
+            }
+            return best;
+        }
+
+        Mesh<T> meshData;
+        std::vector<int> samples;
+        PointGrid<T> grid;
+    };
+
+}
+
+std::vector<delaunay::Point<double>> toDelaunayPolygon(const std::vector<Point>& polygon) {
+    std::vector<delaunay::Point<double>> result;
+    result.reserve(polygon.size());
+    for (const auto& point : polygon) {
+        result.emplace_back(point.x, point.y);
+    }
+    return result;
+}
+
+std::vector<delaunay::Point<double>> readPointsFromFile(const std::string& filename) {
+    std::vector<delaunay::Point<double>> points;
+    std::ifstream file(filename);
+    if (file.is_open()) {
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            double x, y;
+            if (iss >> x >> y) {
+                points.push_back(delaunay::Point<double>(x, y));
+            }
+        }
+        file.close();
+    }
+    else {
+        std::cerr << "Unable to open file: " << filename << std::endl;
+    }
+    return points;
+}
+class ViewController {
+public:
+    explicit ViewController(const sf::RenderWindow& window);
+    void handleEvent(const sf::Event& event, const sf::RenderWindow& window);
+    const sf::View& getView() const;
+    sf::Vector2f toWorld(const sf::RenderWindow& window, int x, int y) const;
+private:
+    sf::View view;
+    bool dragging;
+    sf::Vector2i lastMouse;
+};
+
+ViewController::ViewController(const sf::RenderWindow& window) : view(window.getDefaultView()), dragging(false) {
+}
+
+void ViewController::handleEvent(const sf::Event& event, const sf::RenderWindow& window) {
+    if (event.type == sf::Event::MouseWheelScrolled && event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+        sf::Vector2i pixel(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+        sf::Vector2f before = window.mapPixelToCoords(pixel, view);
+        view.zoom(event.mouseWheelScroll.delta > 0 ? 0.8f : 1.25f);
+        sf::Vector2f after = window.mapPixelToCoords(pixel, view);
+        view.move(before - after);
+    }
+    else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Right) {
+        dragging = true;
+        lastMouse = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+    }
+    else if (event.type == sf::Event::MouseButtonReleased && event.mouseButton.button == sf::Mouse::Right) {
+        dragging = false;
+    }
+    else if (event.type == sf::Event::MouseMoved && dragging) {
+        sf::Vector2i mouse(event.mouseMove.x, event.mouseMove.y);
+        view.move(window.mapPixelToCoords(lastMouse, view) - window.mapPixelToCoords(mouse, view));
+        lastMouse = mouse;
+    }
+}
+
+const sf::View& ViewController::getView() const {
+    return view;
+}
+
+sf::Vector2f ViewController::toWorld(const sf::RenderWindow& window, int x, int y) const {
+    return window.mapPixelToCoords(sf::Vector2i(x, y), view);
+}
+
+// Quadtree over line segments and points. Nodes smaller than lodPixels on screen are drawn
+// as a single tile in the average colour of their contents instead of being descended into.
+class SceneQuadtree {
+public:
+    SceneQuadtree();
+    void clear();
+    void addSegment(sf::Vector2f a, sf::Vector2f b, sf::Color color);
+    template <typename P>
+    void addLoop(const std::vector<P>& polygon, sf::Color color);
+    void addPoint(sf::Vector2f position, float radius, sf::Color color);
+    void addTriangulation(const delaunay::Delaunay<double>& triangulation, sf::Color color);
+    void build();
+    void draw(sf::RenderWindow& window);
+private:
+    struct Segment {
+        sf::Vector2f a, b;
+        sf::Color color;
+    };
+    struct Dot {
+        sf::Vector2f position;
+        float radius;
+        sf::Color color;
+    };
+    struct Node {
+        sf::FloatRect bounds;
+        std::array<int, 4> children;
+        std::size_t segmentBegin, segmentEnd, dotBegin, dotEnd;
+        sf::Color tile;
+    };
+    int buildNode(std::size_t segmentBegin, std::size_t segmentEnd, std::size_t dotBegin, std::size_t dotEnd, sf::FloatRect region, int depth);
+    void drawNode(int node, const sf::FloatRect& viewRect, float pixelSize);
+    void appendQuad(sf::Vector2f center, sf::Vector2f half, sf::Color color);
+
+    std::vector<Segment> segments;
+    std::vector<Dot> dots;
+    std::vector<Node> nodes;
+    sf::VertexArray lines;
+    sf::VertexArray quads;
+    float lodPixels;
+};
+
+SceneQuadtree::SceneQuadtree() : lines(sf::Lines), quads(sf::Triangles), lodPixels(6) {
+}
+
+void SceneQuadtree::clear() {
+    segments.clear();
+    dots.clear();
+    nodes.clear();
+}
+
+void SceneQuadtree::addSegment(sf::Vector2f a, sf::Vector2f b, sf::Color color) {
+    segments.push_back({ a, b, color });
+}
+
+template <typename P>
+void SceneQuadtree::addLoop(const std::vector<P>& polygon, sf::Color color) {
+    for (std::size_t i = 0; i < polygon.size(); ++i) {
+        const P& a = polygon[i];
+        const P& b = polygon[(i + 1) % polygon.size()];
+        addSegment(sf::Vector2f(static_cast<float>(a.x), static_cast<float>(a.y)), sf::Vector2f(static_cast<float>(b.x), static_cast<float>(b.y)), color);
+    }
+}
+
+void SceneQuadtree::addPoint(sf::Vector2f position, float radius, sf::Color color) {
+    dots.push_back({ position, radius, color });
+}
+
+void SceneQuadtree::addTriangulation(const delaunay::Delaunay<double>& triangulation, sf::Color color) {
+    delaunay::Mesh<double> mesh = delaunay::buildMesh(triangulation);
+    for (std::size_t v = 0; v < mesh.vertices.size(); ++v) {
+        for (int k = mesh.adjacencyOffsets[v]; k < mesh.adjacencyOffsets[v + 1]; ++k) {
+            std::size_t u = mesh.adjacency[k];
+            if (u > v) {
+                addSegment(sf::Vector2f(mesh.vertices[v].x, mesh.vertices[v].y), sf::Vector2f(mesh.vertices[u].x, mesh.vertices[u].y), color);
+            }
+        }
+    }
+}
+
+void SceneQuadtree::build() {
+    nodes.clear();
+    if (segments.empty() && dots.empty()) {
+        return;
+    }
+    float xmin = std::numeric_limits<float>::max(), ymin = xmin;
+    float xmax = std::numeric_limits<float>::lowest(), ymax = xmax;
+    for (const auto& segment : segments) {
+        xmin = std::min({ xmin, segment.a.x, segment.b.x });
+        ymin = std::min({ ymin, segment.a.y, segment.b.y });
+        xmax = std::max({ xmax, segment.a.x, segment.b.x });
+        ymax = std::max({ ymax, segment.a.y, segment.b.y });
+    }
+    for (const auto& dot : dots) {
+        xmin = std::min(xmin, dot.position.x);
+        ymin = std::min(ymin, dot.position.y);
+        xmax = std::max(xmax, dot.position.x);
+        ymax = std::max(ymax, dot.position.y);
+    }
+    buildNode(0, segments.size(), 0, dots.size(), sf::FloatRect(xmin, ymin, xmax - xmin, ymax - ymin), 0);
+}
+
+int SceneQuadtree::buildNode(std::size_t segmentBegin, std::size_t segmentEnd, std::size_t dotBegin, std::size_t dotEnd, sf::FloatRect region, int depth) {
+    const int index = static_cast<int>(nodes.size());
+    nodes.push_back(Node{ region, { { -1, -1, -1, -1 } }, segmentBegin, segmentEnd, dotBegin, dotEnd, sf::Color::Black });
+
+    float xmin = std::numeric_limits<float>::max(), ymin = xmin;
+    float xmax = std::numeric_limits<float>::lowest(), ymax = xmax;
+    unsigned r = 0, g = 0, b = 0;
+    for (std::size_t i = segmentBegin; i < segmentEnd; ++i) {
+        const Segment& segment = segments[i];
+        xmin = std::min({ xmin, segment.a.x, segment.b.x });
+        ymin = std::min({ ymin, segment.a.y, segment.b.y });
+        xmax = std::max({ xmax, segment.a.x, segment.b.x });
+        ymax = std::max({ ymax, segment.a.y, segment.b.y });
+        r += segment.color.r;
+        g += segment.color.g;
+        b += segment.color.b;
+    }
+    for (std::size_t i = dotBegin; i < dotEnd; ++i) {
+        const Dot& dot = dots[i];
+        xmin = std::min(xmin, dot.position.x);
+        ymin = std::min(ymin, dot.position.y);
+        xmax = std::max(xmax, dot.position.x);
+        ymax = std::max(ymax, dot.position.y);
+        r += dot.color.r;
+        g += dot.color.g;
+        b += dot.color.b;
+    }
+    const std::size_t count = (segmentEnd - segmentBegin) + (dotEnd - dotBegin);
+    nodes[index].bounds = sf::FloatRect(xmin, ymin, xmax - xmin, ymax - ymin);
+    nodes[index].tile = sf::Color(r / count, g / count, b / count);
+
+    if (count <= 32 || depth >= 16) {
+        return index;
+    }
+
+    const float cx = region.left + region.width / 2;
+    const float cy = region.top + region.height / 2;
+    auto segmentLeft = [cx](const Segment& s) { return s.a.x + s.b.x < 2 * cx; };
+    auto segmentTop = [cy](const Segment& s) { return s.a.y + s.b.y < 2 * cy; };
+    auto dotLeft = [cx](const Dot& d) { return d.position.x < cx; };
+    auto dotTop = [cy](const Dot& d) { return d.position.y < cy; };
+
+    const std::size_t segmentMid = std::partition(segments.begin() + segmentBegin, segments.begin() + segmentEnd, segmentLeft) - segments.begin();
+    const std::size_t segmentSplits[5] = {
+        segmentBegin,
+        static_cast<std::size_t>(std::partition(segments.begin() + segmentBegin, segments.begin() + segmentMid, segmentTop) - segments.begin()),
+        segmentMid,
+        static_cast<std::size_t>(std::partition(segments.begin() + segmentMid, segments.begin() + segmentEnd, segmentTop) - segments.begin()),
+        segmentEnd
+    };
+    const std::size_t dotMid = std::partition(dots.begin() + dotBegin, dots.begin() + dotEnd, dotLeft) - dots.begin();
+    const std::size_t dotSplits[5] = {
+        dotBegin,
+        static_cast<std::size_t>(std::partition(dots.begin() + dotBegin, dots.begin() + dotMid, dotTop) - dots.begin()),
+        dotMid,
+        static_cast<std::size_t>(std::partition(dots.begin() + dotMid, dots.begin() + dotEnd, dotTop) - dots.begin()),
+        dotEnd
+    };
+    const sf::FloatRect quadrants[4] = {
+        sf::FloatRect(region.left, region.top, cx - region.left, cy - region.top),
+        sf::FloatRect(region.left, cy, cx - region.left, region.top + region.height - cy),
+        sf::FloatRect(cx, region.top, region.left + region.width - cx, cy - region.top),
+        sf::FloatRect(cx, cy, region.left + region.width - cx, region.top + region.height - cy)
+    };
+
+    for (int q = 0; q < 4; ++q) {
+        if (segmentSplits[q] == segmentSplits[q + 1] && dotSplits[q] == dotSplits[q + 1]) {
+            continue;
+        }
+        const int child = buildNode(segmentSplits[q], segmentSplits[q + 1], dotSplits[q], dotSplits[q + 1], quadrants[q], depth + 1);
+        nodes[index].children[q] = child;
+    }
+    return index;
+}
+
+void SceneQuadtree::appendQuad(sf::Vector2f center, sf::Vector2f half, sf::Color color) {
+    const sf::Vector2f corners[4] = {
+        sf::Vector2f(center.x - half.x, center.y - half.y),
+        sf::Vector2f(center.x + half.x, center.y - half.y),
+        sf::Vector2f(center.x + half.x, center.y + half.y),
+        sf::Vector2f(center.x - half.x, center.y + half.y)
+    };
+    for (int k : { 0, 1, 2, 0, 2, 3 }) {
+        quads.append(sf::Vertex(corners[k], color));
+    }
+}
+
+void SceneQuadtree::drawNode(int index, const sf::FloatRect& viewRect, float pixelSize) {
+    const Node& node = nodes[index];
+    const float margin = 8 * pixelSize;
+    const sf::FloatRect padded(node.bounds.left - margin, node.bounds.top - margin, node.bounds.width + 2 * margin, node.bounds.height + 2 * margin);
+    if (!padded.intersects(viewRect)) {
+        return;
+    }
+
+    const float lod = lodPixels * pixelSize;
+    const bool leaf = node.children[0] < 0 && node.children[1] < 0 && node.children[2] < 0 && node.children[3] < 0;
+    if (!leaf && node.bounds.width < lod && node.bounds.height < lod) {
+        sf::Vector2f center(node.bounds.left + node.bounds.width / 2, node.bounds.top + node.bounds.height / 2);
+        sf::Vector2f half(std::max(node.bounds.width / 2, pixelSize), std::max(node.bounds.height / 2, pixelSize));
+        appendQuad(center, half, node.tile);
+        return;
+    }
+
+    if (leaf) {
+        for (std::size_t i = node.segmentBegin; i < node.segmentEnd; ++i) {
+            lines.append(sf::Vertex(segments[i].a, segments[i].color));
+            lines.append(sf::Vertex(segments[i].b, segments[i].color));
+        }
+        for (std::size_t i = node.dotBegin; i < node.dotEnd; ++i) {
+            const float radius = dots[i].radius * pixelSize;
+            appendQuad(dots[i].position, sf::Vector2f(radius, radius), dots[i].color);
+        }
+        return;
+    }
+
+    for (int child : node.children) {
+        if (child >= 0) {
+            drawNode(child, viewRect, pixelSize);
+        }
+    }
+}
+
+void SceneQuadtree::draw(sf::RenderWindow& window) {
+    lines.clear();
+    quads.clear();
+    if (!nodes.empty()) {
+        const sf::View& view = window.getView();
+        const sf::FloatRect viewRect(view.getCenter().x - view.getSize().x / 2, view.getCenter().y - view.getSize().y / 2, view.getSize().x, view.getSize().y);
+        drawNode(0, viewRect, view.getSize().x / window.getSize().x);
+    }
+    window.draw(lines);
+    window.draw(quads);
+}
+
+template <typename P>
+void buildHullScene(SceneQuadtree& scene, std::vector<P>& points) {
+    scene.clear();
+    for (const auto& point : points) {
+        scene.addPoint(sf::Vector2f(static_cast<float>(point.x), static_cast<float>(point.y)), 5, sf::Color::Blue);
+    }
+    if (points.size() >= 3) {
+        scene.addLoop(convexHull(points), sf::Color::Red);
+    }
+    scene.build();
+}
+
+void buildDelaunayScene(SceneQuadtree& scene, const delaunay::Delaunay<double>& triangulation, const std::vector<delaunay::Point<double>>& points, float pointRadius) {
+    scene.clear();
+    scene.addTriangulation(triangulation, sf::Color::Black);
+    for (const auto& point : points) {
+        scene.addPoint(sf::Vector2f(point.x, point.y), pointRadius, sf::Color::Black);
+    }
+    scene.build();
+}
+
+void drawProgress(sf::RenderWindow& window, float progress) {
+    window.setView(window.getDefaultView());
+    sf::RectangleShape bar(sf::Vector2f(window.getSize().x * progress, 6));
+    bar.setFillColor(sf::Color(0, 120, 215));
+    window.draw(bar);
+}
+
+class VoronoiCanvas {
+public:
+    VoronoiCanvas(int width, int height);
+    template <typename T>
+    void submit(const geometry::Sites<T>& sites, const std::vector<sf::Color>& colors);
+    void draw(sf::RenderWindow& window);
+private:
+    int width, height;
+    ComputePipeline<std::vector<sf::Uint8>> pipeline;
+    std::vector<sf::Uint8> pixels;
+    sf::Texture texture;
+    bool hasImage;
+};
+
+VoronoiCanvas::VoronoiCanvas(int width, int height) : width(width), height(height), hasImage(false) {
+    texture.create(width, height);
+}
+
+template <typename T>
+void VoronoiCanvas::submit(const geometry::Sites<T>& sites, const std::vector<sf::Color>& colors) {
+    const int w = width;
+    const int h = height;
+    pipeline.submit([sites, colors, w, h](std::vector<sf::Uint8>& result, JobControl& control) {
+        calculateVoronoiImage(sites, colors, w, h, result, &control);
+    });
+}
+
+void VoronoiCanvas::draw(sf::RenderWindow& window) {
+    if (pipeline.poll(pixels)) {
+        texture.update(pixels.data());
+        hasImage = true;
+    }
+    if (hasImage) {
+        window.draw(sf::Sprite(texture));
+    }
+    if (pipeline.busy()) {
+        drawProgress(window, pipeline.progress());
+    }
+}
+
+struct DelaunayFrame {
+    delaunay::Delaunay<double> triangulation;
+    delaunay::Workspace<double> workspace;
+    SceneQuadtree scene;
+};
+
+class DelaunayCanvas {
+public:
+    void submit(const std::vector<delaunay::Point<double>>& points, float pointRadius);
+    void draw(sf::RenderWindow& window, const sf::View& view);
+private:
+    ComputePipeline<DelaunayFrame> pipeline;
+    DelaunayFrame frame;
+};
+
+void DelaunayCanvas::submit(const std::vector<delaunay::Point<double>>& points, float pointRadius) {
+    pipeline.submit([points, pointRadius](DelaunayFrame& result, JobControl& control) {
+        delaunay::triangulate(points, result.triangulation, result.workspace, &control);
+        if (!control.cancelled) {
+            buildDelaunayScene(result.scene, result.triangulation, points, pointRadius);
+        }
+    });
+}
+
+void DelaunayCanvas::draw(sf::RenderWindow& window, const sf::View& view) {
+    pipeline.poll(frame);
+    window.setView(view);
+    frame.scene.draw(window);
+    if (pipeline.busy()) {
+        drawProgress(window, pipeline.progress());
+    }
+}
+// Single-producer single-consumer ring buffer; capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity);
+    std::size_t push(const T* items, std::size_t count);
+    std::size_t pop(T* out, std::size_t max);
+private:
+    std::vector<T> slots;
+    std::size_t mask;
+    std::atomic<std::size_t> head;
+    char padding[64];
+    std::atomic<std::size_t> tail;
+};
+
+template <typename T>
+SpscRing<T>::SpscRing(std::size_t capacity) : head(0), tail(0) {
+    std::size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    slots.resize(size);
+    mask = size - 1;
+}
+
+template <typename T>
+std::size_t SpscRing<T>::push(const T* items, std::size_t count) {
+    const std::size_t t = tail.load(std::memory_order_relaxed);
+    const std::size_t h = head.load(std::memory_order_acquire);
+    const std::size_t n = std::min(count, slots.size() - (t - h));
+    for (std::size_t i = 0; i < n; ++i) {
+        slots[(t + i) & mask] = items[i];
+    }
+    tail.store(t + n, std::memory_order_release);
+    return n;
+}
+
+template <typename T>
+std::size_t SpscRing<T>::pop(T* out, std::size_t max) {
+    const std::size_t h = head.load(std::memory_order_relaxed);
+    const std::size_t t = tail.load(std::memory_order_acquire);
+    const std::size_t n = std::min(max, t - h);
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = slots[(h + i) & mask];
+    }
+    head.store(h + n, std::memory_order_release);
+    return n;
+}
+
+// Reads "x y" lines from stdin ("-"), a named pipe or growing file (a path), or one client on
+// localhost ("tcp:<port>") and feeds them into the ring. When the ring is full the reader stops
+// reading, which pushes back on the writer through the pipe or TCP window.
+class StreamSource {
+public:
+    explicit StreamSource(std::size_t capacity);
+    void start(const std::string& spec);
+    void stop();
+    std::size_t pop(Point* out, std::size_t max);
+    std::uint64_t received() const;
+private:
+    struct State {
+        SpscRing<Point> ring;
+        std::atomic<bool> stopping;
+        std::atomic<std::uint64_t> received;
+
+        explicit State(std::size_t capacity) : ring(capacity), stopping(false), received(0) {}
+    };
+    static void parse(State& state, const char* first, const char* last, std::vector<Point>& batch);
+    static void flush(State& state, std::vector<Point>& batch);
+    static void readStream(std::shared_ptr<State> state, std::istream& input, bool follow);
+    static void readFile(std::shared_ptr<State> state, std::string path);
+    static void readTcp(std::shared_ptr<State> state, unsigned short port);
+
+    std::shared_ptr<State> state;
+};
+
+StreamSource::StreamSource(std::size_t capacity) : state(std::make_shared<State>(capacity)) {
+}
+
+void StreamSource::start(const std::string& spec) {
+    std::thread reader;
+    if (spec == "-" || spec == "stdin") {
+        reader = std::thread(readStream, state, std::ref(std::cin), false);
+    }
+    else if (spec.compare(0, 4, "tcp:") == 0) {
+        reader = std::thread(readTcp, state, static_cast<unsigned short>(std::atoi(spec.c_str() + 4)));
+    }
+    else {
+        reader = std::thread(readFile, state, spec);
+    }
+    // The reader may be blocked inside a read that cannot be interrupted portably; it owns
+    // its share of the state and exits on its own once the source closes or stop() is seen.
+    reader.detach();
+}
+
+void StreamSource::stop() {
+    state->stopping = true;
+}
+
+std::size_t StreamSource::pop(Point* out, std::size_t max) {
+    return state->ring.pop(out, max);
+}
+
+std::uint64_t StreamSource::received() const {
+    return state->received.load();
+}
+
+void StreamSource::parse(State& state, const char* first, const char* last, std::vector<Point>& batch) {
+    char* end = nullptr;
+    const double x = std::strtod(first, &end);
+    if (end == first || end >= last) {
+        return;
+    }
+    const char* next = end;
+    const double y = std::strtod(next, &end);
+    if (end == next || end > last) {
+        return;
+    }
+    batch.push_back({ x, y });
+    if (batch.size() >= 4096) {
+        flush(state, batch);
+    }
+}
+
+void StreamSource::flush(State& state, std::vector<Point>& batch) {
+    std::size_t done = 0;
+    while (done < batch.size() && !state.stopping) {
+        const std::size_t pushed = state.ring.push(batch.data() + done, batch.size() - done);
+        done += pushed;
+        if (pushed == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    state.received += done;
+    batch.clear();
+}
+
+void StreamSource::readStream(std::shared_ptr<State> state, std::istream& input, bool follow) {
+    std::vector<Point> batch;
+    std::string line;
+    std::string partial;
+    while (!state->stopping) {
+        // A line cut off by EOF may still be being written; keep it until its newline arrives.
+        if (std::getline(input, line)) {
+            partial += line;
+            if (!input.eof()) {
+                parse(*state, partial.c_str(), partial.c_str() + partial.size(), batch);
+                partial.clear();
+                continue;
+            }
+        }
+        flush(*state, batch);
+        if (!follow) {
+            break;
+        }
+        input.clear();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!follow && !partial.empty()) {
+        parse(*state, partial.c_str(), partial.c_str() + partial.size(), batch);
+    }
+    flush(*state, batch);
+}
+
+void StreamSource::readFile(std::shared_ptr<State> state, std::string path) {
+    std::ifstream input(path);
+    if (!input.is_open()) {
+        std::cerr << "Unable to open stream: " << path << std::endl;
+        return;
+    }
+    readStream(state, input, true);
+}
+
+void StreamSource::readTcp(std::shared_ptr<State> state, unsigned short port) {
+    sf::TcpListener listener;
+    if (listener.listen(port, sf::IpAddress::LocalHost) != sf::Socket::Done) {
+        std::cerr << "Unable to listen on port " << port << std::endl;
+        return;
+    }
+    sf::TcpSocket socket;
+    if (listener.accept(socket) != sf::Socket::Done) {
+        return;
+    }
+
+    std::vector<Point> batch;
+    std::vector<char> buffer(1 << 16);
+    std::string pending;
+    std::size_t received = 0;
+    while (!state->stopping && socket.receive(buffer.data(), buffer.size(), received) == sf::Socket::Done) {
+        pending.append(buffer.data(), received);
+        std::size_t begin = 0;
+        for (std::size_t end = pending.find('\n'); end != std::string::npos; end = pending.find('\n', begin)) {
+            parse(*state, pending.c_str() + begin, pending.c_str() + end, batch);
+            begin = end + 1;
+        }
+        pending.erase(0, begin);
+        flush(*state, batch);
+    }
+    // The peer closed the connection, so an unterminated last line is complete.
+    if (!state->stopping && !pending.empty()) {
+        parse(*state, pending.c_str(), pending.c_str() + pending.size(), batch);
+    }
+    flush(*state, batch);
+}
+
+// Keeps the convex hull of every point received and a Delaunay mesh (with its Voronoi dual)
+// of a sliding window over the most recent points. The mesh grows to twice meshCapacity points
+// and is then rebuilt from the newest meshCapacity of them, so memory stays bounded and each
+// point costs amortised O(1) rebuild work on top of its walk and cavity. Its super-triangle
+// follows the data: a point outside the current bounds triggers a rebuild over a larger box.
+class StreamingScene {
+public:
+    StreamingScene(int width, int height, std::size_t meshCapacity);
+    void add(const Point* first, const Point* last);
+    void update(sf::Time budget);
+    bool isChanged() const;
+    void build(SceneQuadtree& scene);
+    std::size_t hullSize() const;
+    std::size_t meshSize() const;
+private:
+    void rebuild();
+    bool inBounds(const delaunay::Point<double>& p) const;
+    int insert(const delaunay::Point<double>& p);
+
+    std::vector<Point> hull;
+    std::vector<Point> merged;
+    std::deque<delaunay::Point<double>> queued;
+    std::vector<delaunay::Point<double>> sites;
+    std::vector<int> order;
+    std::vector<int> hints;
+    delaunay::IncrementalMesh<double> mesh;
+    double bounds[4];
+    std::size_t meshCapacity;
+    bool changed;
+    static const int hintCells = 64;
+};
+
+StreamingScene::StreamingScene(int width, int height, std::size_t meshCapacity) : bounds{ 0, 0, static_cast<double>(width), static_cast<double>(height) }, meshCapacity(meshCapacity), changed(false) {
+    mesh.reset(bounds[0], bounds[1], bounds[2], bounds[3]);
+    hints.assign(hintCells * hintCells, -1);
+}
+
+void StreamingScene::add(const Point* first, const Point* last) {
+    if (first == last) {
+        return;
+    }
+    merged.assign(hull.begin(), hull.end());
+    merged.insert(merged.end(), first, last);
+    hull = merged.size() >= 3 ? convexHull(merged) : merged;
+
+    // Only the newest meshCapacity points can end up in the window, so older queued ones are dropped.
+    if (static_cast<std::size_t>(last - first) >= meshCapacity) {
+        queued.clear();
+        first = last - meshCapacity;
+    }
+    for (const Point* it = first; it != last; ++it) {
+        queued.emplace_back(it->x, it->y);
+    }
+    while (queued.size() > meshCapacity) {
+        queued.pop_front();
+    }
+    changed = true;
+}
+
+void StreamingScene::update(sf::Time budget) {
+    sf::Clock clock;
+    std::size_t count = 0;
+    while (!queued.empty() && clock.getElapsedTime() < budget) {
+        const auto p = queued.front();
+        queued.pop_front();
+        sites.push_back(p);
+        if (sites.size() >= 2 * meshCapacity) {
+            sites.erase(sites.begin(), sites.end() - meshCapacity);
+            rebuild();
+        }
+        else if (!inBounds(p)) {
+            rebuild();
+        }
+        else if (insert(p) < 0) {
+            sites.pop_back();
+        }
+        ++count;
+    }
+    changed = changed || count > 0;
+}
+
+bool StreamingScene::inBounds(const delaunay::Point<double>& p) const {
+    return p.x >= bounds[0] && p.y >= bounds[1] && p.x <= bounds[2] && p.y <= bounds[3];
+}
+
+// Reinserts the window into a fresh mesh whose box covers it with room to grow on every side.
+void StreamingScene::rebuild() {
+    double xmin = bounds[0], ymin = bounds[1], xmax = bounds[2], ymax = bounds[3];
+    if (!sites.empty()) {
+        xmin = xmax = sites[0].x;
+        ymin = ymax = sites[0].y;
+        for (const auto& p : sites) {
+            xmin = std::min(xmin, p.x);
+            xmax = std::max(xmax, p.x);
+            ymin = std::min(ymin, p.y);
+            ymax = std::max(ymax, p.y);
+        }
+    }
+    const double margin = std::max({ xmax - xmin, ymax - ymin, 1.0 }) / 2;
+    bounds[0] = xmin - margin;
+    bounds[1] = ymin - margin;
+    bounds[2] = xmax + margin;
+    bounds[3] = ymax + margin;
+    mesh.reset(bounds[0], bounds[1], bounds[2], bounds[3]);
+    hints.assign(hintCells * hintCells, -1);
+    delaunay::hilbertOrder(sites, order);
+    for (int i : order) {
+        insert(sites[i]);
+    }
+}
+
+// Stream order is random, so walks start from the last vertex inserted in the same coarse cell
+// rather than from the previous point.
+int StreamingScene::insert(const delaunay::Point<double>& p) {
+    const int cx = std::min(hintCells - 1, static_cast<int>((p.x - bounds[0]) / (bounds[2] - bounds[0]) * hintCells));
+    const int cy = std::min(hintCells - 1, static_cast<int>((p.y - bounds[1]) / (bounds[3] - bounds[1]) * hintCells));
+    int& hint = hints[static_cast<std::size_t>(cy) * hintCells + cx];
+    const int id = mesh.insert(p, hint >= 0 ? mesh.vertexTriangle[hint] : -1);
+    if (id >= 0) {
+        hint = id;
+    }
+    return id;
+}
+
+bool StreamingScene::isChanged() const {
+    return changed;
+}
+
+void StreamingScene::build(SceneQuadtree& scene) {
+    delaunay::Delaunay<double> visible;
+    mesh.exportTo(visible);
+    delaunay::Mesh<double> indexed = delaunay::buildMesh(visible);
+    std::vector<delaunay::Edge<double>> voronoi;
+    delaunay::voronoiEdges(visible, indexed, voronoi);
+
+    scene.clear();
+    for (const auto& e : voronoi) {
+        scene.addSegment(sf::Vector2f(e.p0.x, e.p0.y), sf::Vector2f(e.p1.x, e.p1.y), sf::Color(0, 160, 0));
+    }
+    for (std::size_t v = 0; v < indexed.vertices.size(); ++v) {
+        for (int k = indexed.adjacencyOffsets[v]; k < indexed.adjacencyOffsets[v + 1]; ++k) {
+            std::size_t u = indexed.adjacency[k];
+            if (u > v) {
+                scene.addSegment(sf::Vector2f(indexed.vertices[v].x, indexed.vertices[v].y), sf::Vector2f(indexed.vertices[u].x, indexed.vertices[u].y), sf::Color::Black);
+            }
+        }
+    }
+    for (const auto& site : sites) {
+        scene.addPoint(sf::Vector2f(site.x, site.y), 2, sf::Color::Black);
+    }
+    scene.addLoop(hull, sf::Color::Red);
+    scene.build();
+    changed = false;
+}
+
+std::size_t StreamingScene::hullSize() const {
+    return hull.size();
+}
+
+std::size_t StreamingScene::meshSize() const {
+    return sites.size();
+}
+
+void runStreaming(const std::string& spec, int width, int height) {
+    StreamSource source(1 << 20);
+    source.start(spec);
+
+    sf::RenderWindow window(sf::VideoMode(width, height), "Streaming");
+    window.setFramerateLimit(60);
+    ViewController viewController(window);
+    StreamingScene streaming(width, height, 20000);
+    SceneQuadtree scene;
+    std::vector<Point> batch(1 << 18);
+    sf::Clock rebuildClock;
+
+    while (window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed)
+                window.close();
+            viewController.handleEvent(event, window);
+        }
+
+        std::size_t count = source.pop(batch.data(), batch.size());
+        streaming.add(batch.data(), batch.data() + count);
+        streaming.update(sf::milliseconds(4));
+        if (streaming.isChanged() && rebuildClock.getElapsedTime().asSeconds() > 0.25f) {
+            streaming.build(scene);
+            rebuildClock.restart();
+            window.setTitle("Streaming: " + std::to_string(source.received()) + " points, hull " +
+                std::to_string(streaming.hullSize()) + ", mesh " + std::to_string(streaming.meshSize()));
+        }
+
+        window.clear(sf::Color::White);
+        window.setView(viewController.getView());
+        scene.draw(window);
+        window.display();
+    }
+    source.stop();
+}
+
+std::vector<Point> points;
+std::vector<Point> convexHullPoints;
+
+
+int main(int argc, char* argv[]) {
+    const int width = 2000;
+    const int height = 1200;
+    const int numPoints = 20;
+    if (argc >= 3 && std::string(argv[1]) == "--stream") {
+        runStreaming(argv[2], width, height);
+        return 0;
+    }
+    sf::RenderWindow window(sf::VideoMode(width, height), "Lab-1");
+
+    sf::Texture normalTexture, clickedTexture;
+    if (!normalTexture.loadFromFile("normal_button.png") || !clickedTexture.loadFromFile("clicked_button.png")) {
+        std::cerr << "Failed to load button textures." << std::endl;
+        return 1;
+    }
+
+    Button mainButton1(&normalTexture, &clickedTexture, "Main Button 1", sf::Vector2f(400, 400));
+    Button mainButton2(&normalTexture, &clickedTexture, "Main Button 2", sf::Vector2f(950, 400));
+    Button mainButton3(&normalTexture, &clickedTexture, "Main Button 3", sf::Vector2f(1500, 400));
+
+    sf::Texture submenuNormalTexture, submenuClickedTexture;
+    if (!submenuNormalTexture.loadFromFile("submenu_normal_button.png") || !submenuClickedTexture.loadFromFile("submenu_normal_button.png")) {
+        std::cerr << "Failed to load submenu button textures." << std::endl;
+        return 1;
+    }
+
+    Button submenuButton1(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 1", sf::Vector2f(400, 500));
+    Button submenuButton2(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 2", sf::Vector2f(400, 600));
+    Button submenuButton3(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 3", sf::Vector2f(400, 700));
+
+    mainButton1.addButton(&submenuButton1);
+    mainButton1.addButton(&submenuButton2);
+    mainButton1.addButton(&submenuButton3);
+
+    Button submenuButton4(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 4", sf::Vector2f(950, 500));
+    Button submenuButton5(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 5", sf::Vector2f(950, 600));
+    Button submenuButton6(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 6", sf::Vector2f(950, 700));
+
+    mainButton2.addButton(&submenuButton4);
+    mainButton2.addButton(&submenuButton5);
+    mainButton2.addButton(&submenuButton6);
+
+    Button submenuButton7(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 7", sf::Vector2f(1500, 500));
+    Button submenuButton8(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 8", sf::Vector2f(1500, 600));
+    Button submenuButton9(&submenuNormalTexture, &submenuClickedTexture, "Submenu Button 9", sf::Vector2f(1500, 700));
 
     mainButton3.addButton(&submenuButton7);
     mainButton3.addButton(&submenuButton8);
@@ -583,23 +3517,23 @@ int main() {
 
     submenuButton1.setAction([&]() {
         sf::RenderWindow window(sf::VideoMode(width, height), "Convex Hull(txt)");
+        ViewController viewController(window);
+        SceneQuadtree scene;
         points.clear();
+        readPointsFromFile(points);
+        buildHullScene(scene, points);
 
         while (window.isOpen()) {
             sf::Event event;
             while (window.pollEvent(event)) {
                 if (event.type == sf::Event::Closed)
                     window.close();
+                viewController.handleEvent(event, window);
             }
 
             window.clear(sf::Color::White);
-            readPointsFromFile(points);
-            drawPointsHull(points, window);
-            if (points.size() >= 3) {
-                std::vector<Point> convexHullPoints = convexHull(points);
-                drawConvexHull(convexHullPoints, window);
-            }
-
+            window.setView(viewController.getView());
+            scene.draw(window);
             window.display();
         }
         });
@@ -614,23 +3548,21 @@ int main() {
         for (int i = 0; i < numPoints; ++i) {
             points.push_back({ disX(gen), disY(gen) });
         }
+        ViewController viewController(window);
+        SceneQuadtree scene;
+        buildHullScene(scene, points);
 
         while (window.isOpen()) {
             sf::Event event;
             while (window.pollEvent(event)) {
                 if (event.type == sf::Event::Closed)
                     window.close();
+                viewController.handleEvent(event, window);
             }
 
             window.clear(sf::Color::White);
-            drawPointsHull(points, window);
-
-            if (points.size() >= 3) {
-                std::vector<Point> convexHullPoints = convexHull(points);
-
-                drawConvexHull(convexHullPoints, window);
-            }
-
+            window.setView(viewController.getView());
+            scene.draw(window);
             window.display();
         }
         });
@@ -638,7 +3570,9 @@ int main() {
 
     submenuButton3.setAction([&window]() {
         sf::RenderWindow window(sf::VideoMode(width, height), "Convex Hull(clicking)");
-        std::vector<Point> points;
+        std::vector<sf::Vector2i> points;
+        ViewController viewController(window);
+        SceneQuadtree scene;
         while (window.isOpen()) {
             sf::Event event;
             while (window.pollEvent(event)) {
@@ -646,19 +3580,17 @@ int main() {
                     window.close();
                 else if (event.type == sf::Event::MouseButtonPressed) {
                     if (event.mouseButton.button == sf::Mouse::Left) {
-                        sf::Vector2i position = sf::Mouse::getPosition(window);
-                        points.push_back({ static_cast<double>(position.x), static_cast<double>(position.y) });
+                        sf::Vector2f position = viewController.toWorld(window, event.mouseButton.x, event.mouseButton.y);
+                        points.emplace_back(static_cast<int>(std::lround(position.x)), static_cast<int>(std::lround(position.y)));
+                        buildHullScene(scene, points);
                     }
                 }
+                viewController.handleEvent(event, window);
             }
 
             window.clear(sf::Color::White);
-            drawPointsHull(points, window);
-            if (points.size() >= 3) {
-                std::vector<Point> convexHullPoints = convexHull(points);
-                drawConvexHull(convexHullPoints, window);
-            }
-
+            window.setView(viewController.getView());
+            scene.draw(window);
             window.display();
         }
         });
@@ -670,9 +3602,13 @@ int main() {
         std::vector<sf::Color> colors;
         points.clear();
         readPointsVoron("points.txt", points);
+        geometry::Sites<float> sites;
         for (size_t i = 0; i < points.size(); ++i) {
             colors.emplace_back(std::rand() % 255, std::rand() % 255, std::rand() % 255);
+            sites.push_back(points[i].x, points[i].y);
         }
+        VoronoiCanvas canvas(width, height);
+        canvas.submit(sites, colors);
         while (window.isOpen()) {
             sf::Event event;
             while (window.pollEvent(event)) {
@@ -680,7 +3616,7 @@ int main() {
                     window.close();
             }
             window.clear(sf::Color::White);
-            drawVoronoiDiagram(window, width, height, points, colors);
+            canvas.draw(window);
             drawPoints(window, points);
             window.display();
         }
@@ -692,6 +3628,12 @@ int main() {
         std::vector<sf::Color> colors;
 
         generateRandomPointsAndColors(numPoints, width, height, points, colors);
+        geometry::Sites<float> sites;
+        for (const auto& point : points) {
+            sites.push_back(point.x, point.y);
+        }
+        VoronoiCanvas canvas(width, height);
+        canvas.submit(sites, colors);
 
         while (window.isOpen()) {
             sf::Event event;
@@ -702,7 +3644,7 @@ int main() {
 
             window.clear(sf::Color::White);
 
-            drawVoronoiDiagram(window, width, height, points, colors);
+            canvas.draw(window);
             drawPoints(window, points);
 
             window.display();
@@ -714,7 +3656,8 @@ int main() {
         sf::RenderWindow window(sf::VideoMode(width, height), "Voronoi Diagram(clicking)");
         std::vector<Point> points;
         std::vector<sf::Color> colors;
-        std::vector<std::vector<Point>> voronoiDiagram3;
+        geometry::Sites<std::int32_t> sites;
+        VoronoiCanvas canvas(width, height);
 
         while (window.isOpen()) {
             sf::Event event;
@@ -729,16 +3672,15 @@ int main() {
                         sf::Color color(std::rand() % 255, std::rand() % 255, std::rand() % 255);
                         colors.push_back(color);
 
-                        voronoiDiagram3.resize(points.size());
-
-                        calculateVoronoiDiagram3(points, voronoiDiagram3, width, height);
+                        sites.push_back(event.mouseButton.x, event.mouseButton.y);
+                        canvas.submit(sites, colors);
                     }
                 }
             }
 
             window.clear(sf::Color::White);
 
-            drawVoronoiDiagram3(window, voronoiDiagram3, colors);
+            canvas.draw(window);
             drawPoints3(window, points);
 
             window.display();
@@ -746,36 +3688,21 @@ int main() {
         });
     submenuButton7.setAction([&]() {
         std::vector<delaunay::Point<double>> points = readPointsFromFile("points.txt");
-        delaunay::Delaunay<double> triangulation = delaunay::triangulate(points);
         sf::RenderWindow window(sf::VideoMode(width, height), "Delaunay Triangulation(txt)");
+        ViewController viewController(window);
+        DelaunayCanvas canvas;
+        canvas.submit(points, 4);
 
         while (window.isOpen()) {
             sf::Event event;
             while (window.pollEvent(event)) {
                 if (event.type == sf::Event::Closed)
                     window.close();
+                viewController.handleEvent(event, window);
             }
 
             window.clear(sf::Color::White);
-
-            for (const auto& triangle : triangulation.triangles) {
-                sf::ConvexShape shape(3);
-                shape.setPoint(0, sf::Vector2f(triangle.p0.x, triangle.p0.y));
-                shape.setPoint(1, sf::Vector2f(triangle.p1.x, triangle.p1.y));
-                shape.setPoint(2, sf::Vector2f(triangle.p2.x, triangle.p2.y));
-                shape.setFillColor(sf::Color::Transparent);
-                shape.setOutlineColor(sf::Color::Black);
-                shape.setOutlineThickness(2);
-                window.draw(shape);
-            }
-
-            for (const auto& point : points) {
-                sf::CircleShape circle(4);
-                circle.setFillColor(sf::Color::Black);
-                circle.setPosition(point.x - 4, point.y - 4);
-                window.draw(circle);
-            }
-
+            canvas.draw(window, viewController.getView());
             window.display();
         }
         });
@@ -788,21 +3715,21 @@ int main() {
             points.push_back(delaunay::Point<double>(x, y));
         }
 
-        delaunay::Delaunay<double> triangulation = delaunay::triangulate(points);
-
         sf::RenderWindow window(sf::VideoMode(width, height), "Delaunay Triangulation(random)");
+        ViewController viewController(window);
+        DelaunayCanvas canvas;
+        canvas.submit(points, 2);
 
         while (window.isOpen()) {
             sf::Event event;
             while (window.pollEvent(event)) {
                 if (event.type == sf::Event::Closed)
                     window.close();
+                viewController.handleEvent(event, window);
             }
 
             window.clear(sf::Color::White);
-
-            drawTrianglesAndPoints(triangulation, points, window);
-
+            canvas.draw(window, viewController.getView());
             window.display();
         }
         });
@@ -810,6 +3737,8 @@ int main() {
         sf::RenderWindow window(sf::VideoMode(width, height), "Delaunay Triangulation(clicking)");
 
         std::vector<delaunay::Point<double>> points;
+        ViewController viewController(window);
+        DelaunayCanvas canvas;
 
         while (window.isOpen()) {
             sf::Event event;
@@ -818,34 +3747,16 @@ int main() {
                     window.close();
                 if (event.type == sf::Event::MouseButtonPressed) {
                     if (event.mouseButton.button == sf::Mouse::Left) {
-                        double x = event.mouseButton.x;
-                        double y = event.mouseButton.y;
-                        points.push_back(delaunay::Point<double>(x, y));
+                        sf::Vector2f position = viewController.toWorld(window, event.mouseButton.x, event.mouseButton.y);
+                        points.push_back(delaunay::Point<double>(position.x, position.y));
+                        canvas.submit(points, 4);
                     }
                 }
+                viewController.handleEvent(event, window);
             }
 
-            delaunay::Delaunay<double> triangulation = delaunay::triangulate(points);
             window.clear(sf::Color::White);
-
-            for (const auto& triangle : triangulation.triangles) {
-                sf::ConvexShape shape(3);
-                shape.setPoint(0, sf::Vector2f(triangle.p0.x, triangle.p0.y));
-                shape.setPoint(1, sf::Vector2f(triangle.p1.x, triangle.p1.y));
-                shape.setPoint(2, sf::Vector2f(triangle.p2.x, triangle.p2.y));
-                shape.setFillColor(sf::Color::Transparent);
-                shape.setOutlineColor(sf::Color::Black);
-                shape.setOutlineThickness(2);
-                window.draw(shape);
-            }
-
-            for (const auto& point : points) {
-                sf::CircleShape circle(4);
-                circle.setFillColor(sf::Color::Black);
-                circle.setPosition(point.x - 4, point.y - 4);
-                window.draw(circle);
-            }
-
+            canvas.draw(window, viewController.getView());
             window.display();
         }
         });